@@ -41,6 +41,13 @@
 
 namespace fecmagic {
 
+    // Tells if all of the given types are integral types
+    template<typename... T>
+    struct AreAllIntegral : std::true_type { };
+    
+    template<typename T, typename... TRest>
+    struct AreAllIntegral<T, TRest...> : std::integral_constant<bool, std::is_integral<T>::value && AreAllIntegral<TRest...>::value> { };
+
     /**
      * @brief Represents a matrix that consists of zeroes and ones, with the given number of rows and columns.
      *
@@ -88,27 +95,35 @@ namespace fecmagic {
         /**
          * Creates an empty BinaryMatrix instance, filled with zeroes.
          */
-        constexpr inline explicit BinaryMatrix() {
-            std::memset(bytes, 0, byteCount);
-        }
+        constexpr inline explicit BinaryMatrix()
+            : bytes{} { }
         
         /**
          * Creates a BinaryMatrix instance by copying a byte array.
          */
-        constexpr inline explicit BinaryMatrix(std::uint8_t *b) {
+        inline explicit BinaryMatrix(const std::uint8_t *b) {
             std::memcpy(bytes, b, byteCount);
         }
         
         /**
-         * Creates a BinaryMatrix instance from an initializer list of bytes that are copied.
+         * Creates a BinaryMatrix instance from a brace-enclosed list of bytes,
+         * the missing bytes are zero.
+         * This is constexpr, so code matrices can be compile-time constants.
          */
-        constexpr inline BinaryMatrix(const std::initializer_list<uint8_t> &init) {
-            size_t i = 0;
-            for (auto it = init.begin(); it != init.end(); it++) {
-                bytes[i++] = *it;
-            }
+        template<typename... TBytes, typename = typename std::enable_if<(sizeof...(TBytes) >= 2) && AreAllIntegral<TBytes...>::value>::type>
+        constexpr inline BinaryMatrix(TBytes... b)
+            : bytes{ static_cast<std::uint8_t>(b)... } {
+            static_assert(sizeof...(TBytes) <= byteCount, "BinaryMatrix: too many bytes for the matrix.");
         }
         
+        /**
+         * Creates a BinaryMatrix instance from its first byte, the other bytes are zero.
+         * Explicit, so that an integer is not converted to a matrix by accident.
+         */
+        template<typename TByte, typename = typename std::enable_if<std::is_integral<TByte>::value>::type>
+        constexpr inline explicit BinaryMatrix(TByte b)
+            : bytes{ static_cast<std::uint8_t>(b) } { }
+        
         /**
          * Gets the internal buffer that stores the bytes that make up the matrix.
          */
@@ -24,6 +24,11 @@
 #ifndef BLOCKCODE_H
 #define BLOCKCODE_H
 
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
 #include "binaryprint.h"
 #include "binarymatrix.h"
 #include "bitmaskcombination.h"
@@ -35,18 +40,25 @@ namespace fecmagic {
      * @brief Base class for block codes.
      * 
      * The BlockCode class implements basic functionality that is useful
-     * for all block codes. It only needs the necessary matrices to work.
-     * However, this class only contains a very wasteful algorithm for
-     * decoding, so it is suggested to create derived classes for specific
-     * block codes that override the decode method.
+     * for all block codes. It only needs the necessary matrices to work,
+     * which the derived class provides as static member functions
+     * (preferably returning constexpr data):
+     * - static const GeneratorMatrix &generatorMatrix()
+     * - static const ParityCheckMatrix &parityCheckMatrix()
+     * - static const DecoderMatrix &decoderMatrix()
+     *
+     * The derived class is given as a template parameter (CRTP), so a derived
+     * class can hide decode with a better algorithm for its code, and the
+     * methods here still call that one, without virtual calls.
      *
      * Template parameters:
+     * - The derived class
      * - Maximum number errors that can be corrected by the code
      * - Type used for storing codewords
      * - Type used for storing a source block
      * - Type used for storing syndromes
      */
-    template<unsigned MaxCorrectedErrors, typename TCodeword, typename TSourceBlock, typename TSyndrome = uint32_t>
+    template<typename TCode, unsigned MaxCorrectedErrors, typename TCodeword, typename TSourceBlock, typename TSyndrome = uint32_t>
     class BlockCode {
     private:
         // Static assertions for some general things
@@ -57,18 +69,150 @@ namespace fecmagic {
         static constexpr unsigned CodewordEffectiveLength = sizeof(TCodeword) * 8;
         static constexpr unsigned SourceBlockEffectiveLength = sizeof(TSourceBlock) * 8;
         static constexpr unsigned SyndromeEffectiveLength = sizeof(TSyndrome) * 8;
-
-        // Matrices
-        BinaryMatrix<CodewordEffectiveLength, SourceBlockEffectiveLength> generator_;
-        BinaryMatrix<SyndromeEffectiveLength, CodewordEffectiveLength> parityCheck_;
-        BinaryMatrix<SourceBlockEffectiveLength, CodewordEffectiveLength> decoder_;
+        
+    public:
+        // Types of codewords, source blocks and syndromes
+        typedef TCodeword Codeword;
+        typedef TSourceBlock SourceBlock;
+        typedef TSyndrome Syndrome;
+        
+        // Types of the matrices
+        typedef BinaryMatrix<CodewordEffectiveLength, SourceBlockEffectiveLength> GeneratorMatrix;
+        typedef BinaryMatrix<SyndromeEffectiveLength, CodewordEffectiveLength> ParityCheckMatrix;
+        typedef BinaryMatrix<SourceBlockEffectiveLength, CodewordEffectiveLength> DecoderMatrix;
+        
+    private:
+        // Use an encoding table when the source block is small enough for this to be worth it
+        static constexpr bool UseEncodingTable = sizeof(TSourceBlock) <= 2;
+        
+        // Use decoding tables when the syndrome is small enough for this to be worth it
+        static constexpr bool UseDecodingTables = sizeof(TSyndrome) <= 2;
+        
+        // Properties that only depend on the generator matrix,
+        // computed once for each code type.
+        struct CodeProperties final {
+            // Codeword of each byte value at each byte position of the source block
+            // (when the encoding table is used). Encoding is linear, so a codeword is the XOR of these.
+            TCodeword encodingTable[UseEncodingTable ? sizeof(TSourceBlock) : 1][256];
+            
+            // Number of bits actually used in source blocks and codewords.
+            // The unused high bits of the types are the all-zero columns and rows
+            // at the beginning of the generator matrix.
+            unsigned sourceBlockLength;
+            unsigned codewordLength;
+            
+            explicit CodeProperties() : sourceBlockLength(0), codewordLength(0) {
+                const GeneratorMatrix &generator = TCode::generatorMatrix();
+                
+                for (unsigned r = 0; r < CodewordEffectiveLength; r++) {
+                    for (unsigned c = 0; c < SourceBlockEffectiveLength; c++) {
+                        if (generator.getBit(r, c)) {
+                            codewordLength = std::max(codewordLength, CodewordEffectiveLength - r);
+                            sourceBlockLength = std::max(sourceBlockLength, SourceBlockEffectiveLength - c);
+                        }
+                    }
+                }
+                
+                if (UseEncodingTable) {
+                    for (unsigned j = 0; j < sizeof(TSourceBlock); j++) {
+                        for (unsigned v = 0; v < 256; v++) {
+                            encodingTable[j][v] = generator.template calculateProduct<TSourceBlock, TCodeword>(static_cast<TSourceBlock>(v << (8 * j)));
+                        }
+                    }
+                }
+            }
+        };
+        
+        static inline const CodeProperties &properties() {
+            static const CodeProperties p;
+            return p;
+        }
+        
+        // Tables for decoding with lookups instead of matrix products and trial and error.
+        // They only depend on the matrices, so they are built once for each code type.
+        struct DecodingTables final {
+            // Syndrome and decoded block of each byte value, at each byte position of the codeword
+            TSyndrome byteSyndromes[sizeof(TCodeword)][256];
+            TSourceBlock byteDecoded[sizeof(TCodeword)][256];
+            
+            // Correctable error pattern (with the fewest errors) of each syndrome, 0 if there is none
+            std::vector<TCodeword> errorPatterns;
+            
+            explicit DecodingTables() {
+                TSyndrome usedSyndromeBits = 0;
+                TCodeword usedCodewordBits = 0;
+                
+                // The matrix products are linear, so the bytes can be multiplied separately
+                for (unsigned j = 0; j < sizeof(TCodeword); j++) {
+                    for (unsigned v = 0; v < 256; v++) {
+                        TCodeword c = static_cast<TCodeword>(static_cast<TCodeword>(v) << (8 * j));
+                        byteSyndromes[j][v] = calculateSyndrome(c);
+                        byteDecoded[j][v] = calculateSourceBlock(c);
+                        usedSyndromeBits |= byteSyndromes[j][v];
+                        if (byteSyndromes[j][v] != 0) {
+                            usedCodewordBits |= c;
+                        }
+                    }
+                }
+                
+                unsigned syndromeBits = 0;
+                while (syndromeBits < SyndromeEffectiveLength && (usedSyndromeBits >> syndromeBits) != 0) {
+                    syndromeBits++;
+                }
+                errorPatterns.resize(static_cast<size_t>(1) << syndromeBits, 0);
+                
+                // Go through the error patterns in the order of the number of errors,
+                // leaving out bits that aren't part of the code
+                for (unsigned errors = 1; errors <= MaxCorrectedErrors; errors++) {
+                    BitmaskCombination<TCodeword, MaxCorrectedErrors> b(errors);
+                    for (TCodeword mask = b.next(); mask != 0; mask = b.next()) {
+                        if ((mask & usedCodewordBits) != mask) {
+                            continue;
+                        }
+                        TSyndrome syndrome = syndromeOf(mask);
+                        if (errorPatterns[syndrome] == 0) {
+                            errorPatterns[syndrome] = mask;
+                        }
+                    }
+                }
+            }
+            
+            inline TSyndrome syndromeOf(const TCodeword &codeword) const {
+                TSyndrome syndrome = 0;
+                for (unsigned j = 0; j < sizeof(TCodeword); j++) {
+                    syndrome ^= byteSyndromes[j][static_cast<uint8_t>(codeword >> (8 * j))];
+                }
+                return syndrome;
+            }
+            
+            inline TSourceBlock decodedOf(const TCodeword &codeword) const {
+                TSourceBlock decoded = 0;
+                for (unsigned j = 0; j < sizeof(TCodeword); j++) {
+                    decoded ^= byteDecoded[j][static_cast<uint8_t>(codeword >> (8 * j))];
+                }
+                return decoded;
+            }
+        };
+        
+        // Returns the decoding tables of the code, which are built on the first call
+        static inline const DecodingTables &decodingTables() {
+            static const DecodingTables tables;
+            return tables;
+        }
         
     protected:
         /**
          * Calculates a syndrome of a codeword.
          */
-        inline TSyndrome calculateSyndrome(const TCodeword &codeword) const {
-            return parityCheck_.template calculateProduct<TCodeword, TSyndrome>(codeword);
+        static inline TSyndrome calculateSyndrome(const TCodeword &codeword) {
+            return TCode::parityCheckMatrix().template calculateProduct<TCodeword, TSyndrome>(codeword);
+        }
+        
+        /**
+         * Calculates the source block of a codeword without checking or fixing it.
+         */
+        static inline TSourceBlock calculateSourceBlock(const TCodeword &codeword) {
+            return TCode::decoderMatrix().template calculateProduct<TCodeword, TSourceBlock>(codeword);
         }
         
         /**
@@ -80,7 +224,7 @@ namespace fecmagic {
          * suggested to use more sophisticated ways for specific
          * codes for which better algorithms exist.
          */
-        inline TCodeword fixCodeword(const TCodeword &codeword, TSyndrome syndrome, bool &success) const {
+        static inline TCodeword fixCodeword(const TCodeword &codeword, TSyndrome syndrome, bool &success) {
     //        std::cout << "Syndrome is: " << BinaryPrint<TSyndrome>(syndrome) << std::endl;
             
             // Try every possible way to flip bits, to a maximum of MaxCorrectedErrors
@@ -103,7 +247,6 @@ namespace fecmagic {
                             return result;
                         }
                         else {
-                            std::cout << "unfixable error detected." << std::endl;
                             success = false;
                             return 0;
                         }
@@ -119,27 +262,231 @@ namespace fecmagic {
 
     public:
         /**
-         * @brief Initializes the BlockCode class.
+         * Encodes a block into a codeword.
+         * Source blocks of at most 16 bits are encoded with a table lookup for each byte.
+         */
+        inline TCodeword encode(const TSourceBlock &input) const {
+            if (UseEncodingTable) {
+                const CodeProperties &p = properties();
+                TCodeword result = p.encodingTable[0][input & 0xff];
+                if (sizeof(TSourceBlock) > 1) {
+                    result ^= p.encodingTable[UseEncodingTable ? sizeof(TSourceBlock) - 1 : 0][(input >> 8) & 0xff];
+                }
+                return result;
+            }
+            
+            return TCode::generatorMatrix().template calculateProduct<TSourceBlock, TCodeword>(input);
+        }
+        
+        /**
+         * Encodes many blocks into codewords at once.
+         *
+         * The blocks are bit-sliced in groups of 64: a transposition turns them into
+         * one 64-bit plane for each bit of the source block, then each bit plane of
+         * the codewords is the XOR of the source planes selected by its generator row,
+         * and another transposition turns the planes back into codewords.
+         * This takes a few word operations per codeword, whatever the code is.
          *
-         * Constructor parameters:
-         * - Generator matrix
-         * - Parity check matrix
-         * - Decoder matrix
+         * Source blocks of at most 16 bits are encoded with the encoding table
+         * instead, because that is even faster.
          */
-        inline explicit BlockCode(const decltype(generator_) &generator, const decltype(parityCheck_) &parityCheck, const decltype(decoder_) &decoder)
-            : generator_(generator), parityCheck_(parityCheck), decoder_(decoder) { }
+        inline void encodeBatch(const TSourceBlock *input, size_t count, TCodeword *output) const {
+            static_assert(sizeof(TSourceBlock) <= 8 && sizeof(TCodeword) <= 8, "Bit-sliced encoding needs blocks and codewords of at most 64 bits.");
+            
+            if (UseEncodingTable) {
+                for (size_t i = 0; i < count; i++) {
+                    output[i] = encode(input[i]);
+                }
+                return;
+            }
+            
+            for (size_t start = 0; start < count; start += 64) {
+                size_t n = (count - start) < 64 ? (count - start) : 64;
+                
+                // One row for each source block, MSB first, the unused rows are zero
+                uint8_t blockBytes[64 * sizeof(TSourceBlock)] = { 0 };
+                for (size_t i = 0; i < n; i++) {
+                    for (unsigned j = 0; j < sizeof(TSourceBlock); j++) {
+                        blockBytes[i * sizeof(TSourceBlock) + j] = static_cast<uint8_t>(input[start + i] >> (8 * (sizeof(TSourceBlock) - j - 1)));
+                    }
+                }
+                uint64_t sourcePlanes[SourceBlockEffectiveLength];
+                std::memcpy(sourcePlanes, BinaryMatrix<64, SourceBlockEffectiveLength>(blockBytes).transpose().getBytes(), sizeof(sourcePlanes));
+                
+                // Each codeword plane is the XOR of the source planes selected by a generator row
+                // (masked instead of branching, because the selection is unpredictable)
+                uint8_t codewordPlaneBytes[CodewordEffectiveLength * 8];
+                for (unsigned r = 0; r < CodewordEffectiveLength; r++) {
+                    uint64_t plane = 0;
+                    const uint8_t *generatorRow = TCode::generatorMatrix().getRow(r);
+                    for (unsigned c = 0; c < SourceBlockEffectiveLength; c++) {
+                        uint64_t selected = (generatorRow[c / 8] >> (7 - c % 8)) & 1;
+                        plane ^= sourcePlanes[c] & (0 - selected);
+                    }
+                    std::memcpy(codewordPlaneBytes + r * 8, &plane, 8);
+                }
+                BinaryMatrix<64, CodewordEffectiveLength> codewords = BinaryMatrix<CodewordEffectiveLength, 64>(codewordPlaneBytes).transpose();
+                
+                for (size_t i = 0; i < n; i++) {
+                    const uint8_t *codewordBytes = codewords.getRow(i);
+                    TCodeword codeword = 0;
+                    for (unsigned j = 0; j < sizeof(TCodeword); j++) {
+                        codeword = static_cast<TCodeword>((codeword << 8) | codewordBytes[j]);
+                    }
+                    output[start + i] = codeword;
+                }
+            }
+        }
         
         /**
-         * Encodes a block into a codeword.
+         * Gets the number of bits in a source block, eg. 12 for Golay(24, 12).
          */
-        inline TCodeword encode(const TSourceBlock &input) const {
-            return generator_.template calculateProduct<TSourceBlock, TCodeword>(input);
+        inline unsigned sourceBlockLength() const {
+            return properties().sourceBlockLength;
+        }
+        
+        /**
+         * Gets the number of bits in a codeword, eg. 24 for Golay(24, 12).
+         */
+        inline unsigned codewordLength() const {
+            return properties().codewordLength;
+        }
+        
+        /**
+         * Calculates the number of blocks a byte stream of the given size is split into.
+         */
+        inline size_t calculateBlockCount(size_t size) const {
+            return (size * 8 + properties().sourceBlockLength - 1) / properties().sourceBlockLength;
+        }
+        
+        /**
+         * Calculates the size of the packed codewords of a byte stream of the given size.
+         */
+        inline size_t calculateEncodedSize(size_t size) const {
+            return (calculateBlockCount(size) * properties().codewordLength + 7) / 8;
+        }
+        
+        /**
+         * Encodes a byte stream.
+         *
+         * The input is split into source blocks MSB first (the last one is padded
+         * with zeroes), and the codewords are packed after each other MSB first.
+         * The output must be calculateEncodedSize(inputSize) bytes long.
+         */
+        inline void encodeBuffer(const uint8_t *input, size_t inputSize, uint8_t *output) const {
+            static_assert(sizeof(TCodeword) <= 4, "Buffer encoding needs codewords of at most 32 bits.");
+            
+            const unsigned blockBits = properties().sourceBlockLength;
+            const unsigned codewordBits = properties().codewordLength;
+            size_t blockCount = calculateBlockCount(inputSize);
+            uint64_t inputBits = 0, outputBits = 0;
+            unsigned inputBitCount = 0, outputBitCount = 0;
+            size_t inputPos = 0, outputPos = 0;
+            
+            for (size_t i = 0; i < blockCount; i++) {
+                // Take the next source block
+                while (inputBitCount < blockBits) {
+                    inputBits = (inputBits << 8) | (inputPos < inputSize ? input[inputPos] : 0);
+                    inputPos++;
+                    inputBitCount += 8;
+                }
+                inputBitCount -= blockBits;
+                TSourceBlock block = static_cast<TSourceBlock>((inputBits >> inputBitCount) & ((static_cast<uint64_t>(1) << blockBits) - 1));
+                
+                // Append its codeword to the output
+                outputBits = (outputBits << codewordBits) | encode(block);
+                outputBitCount += codewordBits;
+                while (outputBitCount >= 8) {
+                    outputBitCount -= 8;
+                    output[outputPos++] = static_cast<uint8_t>(outputBits >> outputBitCount);
+                }
+            }
+            
+            if (outputBitCount > 0) {
+                output[outputPos] = static_cast<uint8_t>(outputBits << (8 - outputBitCount));
+            }
+        }
+        
+        /**
+         * Decodes a byte stream encoded by encodeBuffer.
+         *
+         * The output size is the size of the original byte stream.
+         * When a status bitmap of (calculateBlockCount(outputSize) + 7) / 8 bytes is given,
+         * the bit of each block (MSB first) is set when it had an unfixable error.
+         * The source bits of such blocks are zero.
+         *
+         * Returns the number of blocks with unfixable errors.
+         */
+        inline size_t decodeBuffer(const uint8_t *input, size_t outputSize, uint8_t *output, uint8_t *status = nullptr) const {
+            static_assert(sizeof(TCodeword) <= 4, "Buffer decoding needs codewords of at most 32 bits.");
+            
+            const unsigned blockBits = properties().sourceBlockLength;
+            const unsigned codewordBits = properties().codewordLength;
+            size_t blockCount = calculateBlockCount(outputSize);
+            uint64_t inputBits = 0, outputBits = 0;
+            unsigned inputBitCount = 0, outputBitCount = 0;
+            size_t inputPos = 0, outputPos = 0;
+            size_t failedBlocks = 0;
+            
+            if (status != nullptr) {
+                std::memset(status, 0, (blockCount + 7) / 8);
+            }
+            
+            for (size_t i = 0; i < blockCount; i++) {
+                // Take the next codeword
+                while (inputBitCount < codewordBits) {
+                    inputBits = (inputBits << 8) | input[inputPos++];
+                    inputBitCount += 8;
+                }
+                inputBitCount -= codewordBits;
+                TCodeword codeword = static_cast<TCodeword>((inputBits >> inputBitCount) & ((static_cast<uint64_t>(1) << codewordBits) - 1));
+                
+                bool success;
+                TSourceBlock block = static_cast<const TCode *>(this)->decode(codeword, success);
+                if (!success) {
+                    failedBlocks++;
+                    if (status != nullptr) {
+                        status[i / 8] |= static_cast<uint8_t>(0x80 >> (i % 8));
+                    }
+                }
+                
+                // Append the source block to the output, without the padding at the end
+                outputBits = (outputBits << blockBits) | block;
+                outputBitCount += blockBits;
+                while (outputBitCount >= 8 && outputPos < outputSize) {
+                    outputBitCount -= 8;
+                    output[outputPos++] = static_cast<uint8_t>(outputBits >> outputBitCount);
+                }
+            }
+            
+            return failedBlocks;
         }
         
         /**
          * Decodes a codeword into a block, or tells if an unfixable error is detected.
+         *
+         * Codes with syndromes of at most 16 bits are decoded with a syndrome computation
+         * and a table lookup, others by trying the possible corrections.
+         * Derived classes may hide this with a better algorithm for their code.
          */
-        inline virtual TSourceBlock decode(const TCodeword &input, bool &success) const {
+        inline TSourceBlock decode(const TCodeword &input, bool &success) const {
+            // Look up the error pattern and the decoded block when there are tables
+            if (UseDecodingTables) {
+                const DecodingTables &t = decodingTables();
+                TSyndrome syndrome = t.syndromeOf(input);
+                TCodeword codeword = input;
+                if (syndrome != 0) {
+                    codeword ^= t.errorPatterns[syndrome];
+                    if (codeword == input) {
+                        // No correctable error pattern has this syndrome
+                        success = false;
+                        return 0;
+                    }
+                }
+                success = true;
+                return t.decodedOf(codeword);
+            }
+            
             // Initial value of success is true
             success = true;
             // Check if codeword has any issues
@@ -156,7 +503,7 @@ namespace fecmagic {
             }
             
             // If the codeword is okay, decode it
-            return decoder_.template calculateProduct<TCodeword, TSourceBlock>(codeword);
+            return calculateSourceBlock(codeword);
         }
     };
 
@@ -0,0 +1,168 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_CHASE_DECODER_H
+#define FECMAGIC_CHASE_DECODER_H
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "fecmagic-global.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Chase-II soft-decision decoder for block codes.
+     *
+     * Takes the int8 LLRs of the bits of a codeword (positive means 0, MSB first),
+     * makes hard decisions, then flips the LeastReliableCount least reliable bits
+     * in all 2^LeastReliableCount combinations. Each candidate is decoded with the
+     * hard decoder of the code, and the re-encoded codeword that correlates best
+     * with the LLRs wins. That is the one whose disagreeing bits have the smallest
+     * total reliability. When the hard decisions are already a codeword, that is
+     * the result, so clean codewords take a single hard decoding.
+     *
+     * The metrics are computed with SSE2 (sum of absolute differences over the
+     * reliabilities selected by each candidate) where available.
+     *
+     * Template parameters:
+     * - TCode: the block code, eg. GolayCode or HammingCode
+     * - LeastReliableCount: number of least reliable bits to flip
+     */
+    template<typename TCode, unsigned LeastReliableCount = 4>
+    class ChaseDecoder final {
+        
+    private:
+        typedef typename TCode::Codeword Codeword;
+        typedef typename TCode::SourceBlock SourceBlock;
+        
+        static_assert(sizeof(Codeword) <= 4, "ChaseDecoder: codewords must be at most 32 bits.");
+        static_assert(LeastReliableCount >= 1 && LeastReliableCount <= 8, "ChaseDecoder: LeastReliableCount must be between 1 and 8.");
+        
+        // The hard decoder
+        TCode code_;
+        
+        // Calculates the total reliability of the bits set in the given mask,
+        // where the reliability of codeword bit i is reliabilities[i]
+        static inline unsigned calculateMetric(const uint8_t *reliabilities, uint32_t mask) {
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                // Every byte of the mask goes into 8 lanes, which select their own bits
+                __m128i m = _mm_set1_epi32(static_cast<int>(mask));
+                m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(m, m), _mm_unpacklo_epi8(m, m));
+                __m128i low = _mm_unpacklo_epi32(m, m);
+                __m128i high = _mm_unpackhi_epi32(m, m);
+                const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+                low = _mm_cmpeq_epi8(_mm_and_si128(low, bits), bits);
+                high = _mm_cmpeq_epi8(_mm_and_si128(high, bits), bits);
+                
+                // Sum the selected reliabilities
+                __m128i sum = _mm_add_epi64(
+                    _mm_sad_epu8(_mm_and_si128(low, _mm_load_si128(reinterpret_cast<const __m128i*>(reliabilities))), _mm_setzero_si128()),
+                    _mm_sad_epu8(_mm_and_si128(high, _mm_load_si128(reinterpret_cast<const __m128i*>(reliabilities + 16))), _mm_setzero_si128()));
+                sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+                return static_cast<unsigned>(_mm_cvtsi128_si32(sum));
+            }
+#endif
+            
+            unsigned metric = 0;
+            for (unsigned i = 0; mask != 0; i++, mask >>= 1) {
+                metric += (mask & 1) * reliabilities[i];
+            }
+            return metric;
+        }
+        
+    public:
+        
+        /**
+         * @brief Decodes a codeword from the LLRs of its bits.
+         *
+         * The llr array must have as many elements as the bits of a codeword.
+         * Sets success to false when none of the candidates could be decoded.
+         */
+        inline SourceBlock decode(const int8_t *llr, bool &success) const {
+            unsigned n = code_.codewordLength();
+            
+            // Hard decisions and reliabilities, indexed by codeword bit
+            alignas(16) uint8_t reliabilities[32] = { 0 };
+            Codeword hard = 0;
+            for (unsigned i = 0; i < n; i++) {
+                int8_t x = llr[n - 1 - i];
+                hard |= static_cast<Codeword>(x < 0) << i;
+                reliabilities[i] = static_cast<uint8_t>(x == -128 ? 127 : std::abs(x));
+            }
+            
+            // Find the least reliable bits, with selection sort
+            uint8_t order[32];
+            for (unsigned i = 0; i < n; i++) {
+                order[i] = static_cast<uint8_t>(i);
+            }
+            unsigned count = n < LeastReliableCount ? n : LeastReliableCount;
+            for (unsigned i = 0; i < count; i++) {
+                for (unsigned j = i + 1; j < n; j++) {
+                    if (reliabilities[order[j]] < reliabilities[order[i]]) {
+                        uint8_t t = order[i];
+                        order[i] = order[j];
+                        order[j] = t;
+                    }
+                }
+            }
+            
+            // Try every combination of flipping them
+            SourceBlock best = 0;
+            unsigned bestMetric = ~0u;
+            success = false;
+            for (unsigned pattern = 0; pattern < (1u << count); pattern++) {
+                Codeword candidate = hard;
+                for (unsigned i = 0; i < count; i++) {
+                    candidate ^= static_cast<Codeword>((pattern >> i) & 1) << order[i];
+                }
+                
+                bool decoded;
+                SourceBlock block = code_.decode(candidate, decoded);
+                if (!decoded) {
+                    continue;
+                }
+                
+                // Bits where the re-encoded codeword disagrees with the hard decisions
+                unsigned metric = calculateMetric(reliabilities, static_cast<uint32_t>(code_.encode(block) ^ hard));
+                if (metric < bestMetric) {
+                    bestMetric = metric;
+                    best = block;
+                    success = true;
+                    
+                    // Nothing can beat a codeword that agrees with every hard decision
+                    if (metric == 0) {
+                        break;
+                    }
+                }
+            }
+            
+            return best;
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_CHASE_DECODER_H
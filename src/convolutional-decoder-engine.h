@@ -0,0 +1,437 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_CONVOLUTIONAL_DECODER_ENGINE_H
+#define FECMAGIC_CONVOLUTIONAL_DECODER_ENGINE_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+
+#include "fecmagic-global.h"
+#include "sequence.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Viterbi decoder engine that decodes any number of channels with the same code.
+     *
+     * The engine holds the immutable description of the code: the expected encoder output
+     * of every transition, computed once from the polynomials. Everything that belongs to
+     * a single channel is in a small Context object, which the engine methods take as a
+     * parameter, so a single engine (and its tables, which stay in cache) can service many
+     * channels, and switching between them costs nothing.
+     *
+     * A context keeps 16-bit path metrics and one decision bit per state and step
+     * (the survivor paths), over 2 * Depth steps. Every Depth steps, the decoder traces
+     * back from the best state and outputs the Depth oldest bits, so each bit is decided
+     * with at least Depth steps after it. For example, with K=7 and Depth=35, a context
+     * is about 850 bytes.
+     *
+     * The input and output are the same as for PuncturedConvolutionalDecoder, but an
+     * incomplete symbol at the end of the input is always kept until the next call.
+     *
+     * Template parameters:
+     * - TPuncturingMatrix: a Sequence that describes which bits are punctured
+     * - Depth: the minimum number of steps after a bit that are used for deciding it
+     * - ConstraintLength: the constraint length of the code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - Polynomials: the polynomials used for this convolutional code
+     */
+    template<typename TPuncturingMatrix, uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    class PuncturedConvolutionalDecoderEngine final {
+        
+        // Check template parameters using static asserts
+        static_assert((sizeof(TShiftReg) * 8) >= ConstraintLength, "The shift register must be able to hold the constraint length of the code.");
+        static_assert(Depth >= 2, "The Depth template parameter must be at least two.");
+        static_assert(ConstraintLength >= 2, "The ConstraintLength template parameter must be at least two.");
+        static_assert(ConstraintLength <= 16, "The ConstraintLength template parameter must be at most 16.");
+        static_assert(sizeof...(Polynomials) >= 2, "There must be at least two polynomials.");
+        static_assert(sizeof...(Polynomials) <= 8, "There must be at most eight polynomials.");
+        
+    private:
+        
+        // Number of outputs of the convolutional code (each polynomial corresponds to an output)
+        constexpr static uint32_t outputCount_ = sizeof...(Polynomials);
+        
+        // Unpack variadic template argument, to allow access to each polynomial
+        constexpr static TShiftReg polynomials_[sizeof...(Polynomials)] = { Polynomials... };
+        
+        // Number of states of the encoder (the previous ConstraintLength - 1 bits)
+        constexpr static uint32_t stateCount_ = 1u << (ConstraintLength - 1);
+        
+        // Number of transitions between states (all values of the shift register)
+        constexpr static uint32_t transitionCount_ = 1u << ConstraintLength;
+        
+        // Number of 64-bit words that hold the decisions of a step
+        constexpr static uint32_t decisionWords_ = (stateCount_ + 63) / 64;
+        
+        // Number of steps of which the decisions are kept
+        constexpr static uint32_t tracebackLength_ = 2 * Depth;
+        
+        // Initial metric of the states in which the encoder can't be at the start
+        constexpr static uint16_t unlikelyMetric_ = 0x1000;
+        
+        // Metrics are renormalized when the best one exceeds this
+        constexpr static uint16_t renormalizationThreshold_ = 0x4000;
+        
+        // Expected output of the encoder for each value of the shift register
+        uint8_t expectedOutputs_[transitionCount_];
+        
+    public:
+        
+        /**
+         * @brief State of the decoder for a single channel.
+         *
+         * Create one for each channel, and pass it to the methods of the engine.
+         */
+        class Context final {
+            friend class PuncturedConvolutionalDecoderEngine;
+            
+        private:
+            
+            // Path metrics of each state, double buffered
+            uint16_t metrics[2][stateCount_];
+            
+            // Index of the current path metrics
+            uint32_t currentMetrics;
+            
+            // Decision bits of each state in each step: which of the two possible previous states was chosen
+            uint64_t decisions[tracebackLength_][decisionWords_];
+            
+            // Number of steps in the decisions that aren't output yet
+            uint32_t undecidedSteps;
+            
+            // Position of the next step in the decisions
+            uint32_t decisionPos;
+            
+            // Phase of the puncturing matrix
+            size_t puncturingPhase;
+            
+            // Received bits of an incomplete symbol
+            uint8_t pendingReceivedBits;
+            
+            // Known (not punctured or erased) bits of an incomplete symbol
+            uint8_t pendingKnownBits;
+            
+            // Number of bits in the incomplete symbol
+            uint32_t pendingCount;
+            
+            // Output
+            uint8_t *output;
+            
+            // Current output address
+            size_t outAddr;
+            
+            // Current output bit position
+            uint32_t outBitPos;
+            
+        public:
+            
+            /**
+             * @brief Creates a context, it needs to be reset before use.
+             */
+            explicit Context() : output(nullptr) { }
+            
+            /**
+             * @brief Copy constructor. Intentionally disabled for this class.
+             */
+            Context(const Context &other) = delete;
+            
+            /**
+             * @brief Copy assignment operator. Intentionally disabled for this class.
+             */
+            Context &operator=(const Context &other) = delete;
+            
+        };
+        
+    private:
+        
+        static inline void putOutputBit(Context &context, uint8_t bit) {
+            if (context.outBitPos == 7) {
+                context.output[context.outAddr] = 0;
+            }
+            
+            context.output[context.outAddr] |= static_cast<uint8_t>(bit << context.outBitPos);
+            
+            if (context.outBitPos == 0) {
+                context.outBitPos = 7;
+                context.outAddr++;
+            }
+            else {
+                context.outBitPos--;
+            }
+        }
+        
+        // Returns the state that has the lowest path metric.
+        static inline uint32_t bestState(const Context &context) {
+            const uint16_t *metrics = context.metrics[context.currentMetrics];
+            uint32_t best = 0;
+            for (uint32_t s = 1; s < stateCount_; s++) {
+                if (metrics[s] < metrics[best]) {
+                    best = s;
+                }
+            }
+            return best;
+        }
+        
+        // Traces back from the best state through the undecided steps, and outputs the oldest outputCount of them.
+        static void traceback(Context &context, uint32_t outputCount) {
+            uint8_t bits[tracebackLength_];
+            uint32_t state = bestState(context);
+            uint32_t pos = context.decisionPos;
+            
+            for (uint32_t i = context.undecidedSteps; i > 0; i--) {
+                pos = (pos == 0) ? (tracebackLength_ - 1) : (pos - 1);
+                
+                // The newest bit of the state is the input of the step, and
+                // the decision tells the bit that was shifted out of the previous state
+                bits[i - 1] = static_cast<uint8_t>(state >> (ConstraintLength - 2));
+                uint32_t decision = (context.decisions[pos][state / 64] >> (state % 64)) & 1;
+                state = ((state << 1) & (stateCount_ - 1)) | decision;
+            }
+            
+            for (uint32_t i = 0; i < outputCount; i++) {
+                putOutputBit(context, bits[i]);
+            }
+            context.undecidedSteps -= outputCount;
+        }
+        
+        // Takes a step of the Viterbi algorithm (add-compare-select) with the given received symbol.
+        inline void decodeStep(Context &context, uint8_t receivedBits, uint8_t knownBits) const {
+            // Branch metric of each possible symbol
+            uint16_t branchMetrics[1u << outputCount_];
+            for (uint32_t v = 0; v < (1u << outputCount_); v++) {
+                branchMetrics[v] = ::fecmagic::computePopcount((v ^ receivedBits) & knownBits);
+            }
+            
+            const uint16_t *metrics = context.metrics[context.currentMetrics];
+            uint16_t *newMetrics = context.metrics[context.currentMetrics ^ 1];
+            uint64_t *decisions = context.decisions[context.decisionPos];
+            uint16_t best = 0xffff;
+            
+            for (uint32_t w = 0; w < decisionWords_; w++) {
+                decisions[w] = 0;
+            }
+            
+            // Butterflies: states j and j + stateCount_ / 2 both come from states 2j and 2j + 1,
+            // the transitions only differ in the bit shifted in and the bit shifted out
+            for (uint32_t j = 0; j < stateCount_ / 2; j++) {
+                uint16_t metricA = metrics[2 * j];
+                uint16_t metricB = metrics[2 * j + 1];
+                
+                for (uint32_t high = 0; high < 2; high++) {
+                    uint32_t s = j + high * (stateCount_ / 2);
+                    uint16_t metric0 = metricA + branchMetrics[expectedOutputs_[2 * s]];
+                    uint16_t metric1 = metricB + branchMetrics[expectedOutputs_[2 * s + 1]];
+                    uint64_t decision = (metric1 < metric0) ? 1 : 0;
+                    uint16_t metric = decision ? metric1 : metric0;
+                    
+                    newMetrics[s] = metric;
+                    decisions[s / 64] |= decision << (s % 64);
+                    best = (metric < best) ? metric : best;
+                }
+            }
+            
+            // Keep the metrics small, only their differences matter
+            if (best > renormalizationThreshold_) {
+                for (uint32_t s = 0; s < stateCount_; s++) {
+                    newMetrics[s] -= best;
+                }
+            }
+            
+            context.currentMetrics ^= 1;
+            context.decisionPos = (context.decisionPos + 1 == tracebackLength_) ? 0 : (context.decisionPos + 1);
+            context.undecidedSteps++;
+            
+            if (context.undecidedSteps == tracebackLength_) {
+                traceback(context, tracebackLength_ - Depth);
+            }
+        }
+        
+        template<bool UseErasures>
+        void decodeImpl(Context &context, const void *input, size_t bitOffset, size_t bitCount, const void *erasures) const {
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            const uint8_t *erasureBytes = reinterpret_cast<const uint8_t*>(erasures);
+            assert(inputBytes != nullptr || bitCount == 0);
+            assert(!UseErasures || erasureBytes != nullptr || bitCount == 0);
+            assert(context.output != nullptr);
+            
+            size_t pos = bitOffset;
+            size_t end = bitOffset + bitCount;
+            uint8_t receivedBits = context.pendingReceivedBits;
+            uint8_t knownBits = context.pendingKnownBits;
+            uint32_t count = context.pendingCount;
+            size_t phase = context.puncturingPhase;
+            
+            for (;;) {
+                // Get the bits of the symbol, punctured bits don't need any input
+                while (count < outputCount_) {
+                    bool punctured = (0 == TPuncturingMatrix::numbers[phase]);
+                    if (!punctured && pos == end) {
+                        break;
+                    }
+                    
+                    phase = (phase + 1 == TPuncturingMatrix::count) ? 0 : (phase + 1);
+                    receivedBits = static_cast<uint8_t>(receivedBits << 1);
+                    knownBits = static_cast<uint8_t>(knownBits << 1);
+                    count++;
+                    
+                    if (punctured) {
+                        continue;
+                    }
+                    
+                    uint8_t known = 1;
+                    if (UseErasures) {
+                        known = ((erasureBytes[pos / 8] >> (7 - pos % 8)) & 1) ^ 1;
+                    }
+                    
+                    knownBits |= known;
+                    receivedBits |= ((inputBytes[pos / 8] >> (7 - pos % 8)) & known);
+                    pos++;
+                }
+                
+                if (count < outputCount_) {
+                    // Wait for the rest of the symbol
+                    break;
+                }
+                
+                decodeStep(context, receivedBits, knownBits);
+                receivedBits = 0;
+                knownBits = 0;
+                count = 0;
+            }
+            
+            context.pendingReceivedBits = receivedBits;
+            context.pendingKnownBits = knownBits;
+            context.pendingCount = count;
+            context.puncturingPhase = phase;
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates an engine, and computes the tables of the code.
+         */
+        explicit PuncturedConvolutionalDecoderEngine() {
+            for (uint32_t t = 0; t < transitionCount_; t++) {
+                uint8_t output = 0;
+                for (uint32_t o = 0; o < outputCount_; o++) {
+                    output = static_cast<uint8_t>((output << 1) | ::fecmagic::computeParity(t & polynomials_[o]));
+                }
+                expectedOutputs_[t] = output;
+            }
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        PuncturedConvolutionalDecoderEngine(const PuncturedConvolutionalDecoderEngine &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        PuncturedConvolutionalDecoderEngine &operator=(const PuncturedConvolutionalDecoderEngine &other) = delete;
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         *
+         * Same as for PuncturedConvolutionalDecoder.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            size_t t = inputSize * 8 * TPuncturingMatrix::count;
+            size_t nonPuncturedBits = (t + TPuncturingMatrix::nonZeroes() - 1) / TPuncturingMatrix::nonZeroes();
+            size_t outputBits = (nonPuncturedBits + outputCount_ - 1) / outputCount_;
+            return (outputBits + 7) / 8;
+        }
+        
+        /**
+         * @brief Resets the given context for a new stream, and sets its output.
+         *
+         * The encoder is assumed to start at the 0 state.
+         */
+        void reset(Context &context, void *output) const {
+            for (uint32_t s = 0; s < stateCount_; s++) {
+                context.metrics[0][s] = unlikelyMetric_;
+            }
+            context.metrics[0][0] = 0;
+            context.currentMetrics = 0;
+            context.undecidedSteps = 0;
+            context.decisionPos = 0;
+            context.puncturingPhase = 0;
+            context.pendingReceivedBits = 0;
+            context.pendingKnownBits = 0;
+            context.pendingCount = 0;
+            context.output = reinterpret_cast<uint8_t*>(output);
+            context.outAddr = 0;
+            context.outBitPos = 7;
+        }
+        
+        /**
+         * @brief Decodes the given input of a channel.
+         *
+         * The caller is responsible for making sure that enough memory is allocated
+         * to fit the output. This method is suitable for streaming.
+         */
+        void decode(Context &context, const void *input, size_t inputSize) const {
+            decodeImpl<false>(context, input, 0, inputSize * 8, nullptr);
+        }
+        
+        /**
+         * @brief Decodes the given input of a channel, in which some bits are known to be erased.
+         *
+         * The erasure bitmap has the same layout as the input, each set bit marks an erased bit.
+         */
+        void decode(Context &context, const void *input, size_t inputSize, const void *erasures) const {
+            decodeImpl<true>(context, input, 0, inputSize * 8, erasures);
+        }
+        
+        /**
+         * @brief Outputs the remaining bits of a channel at the end of the stream.
+         *
+         * An incomplete symbol is completed with unknown bits.
+         */
+        void flush(Context &context) const {
+            if (context.pendingCount > 0) {
+                uint32_t missing = outputCount_ - context.pendingCount;
+                decodeStep(context, static_cast<uint8_t>(context.pendingReceivedBits << missing), static_cast<uint8_t>(context.pendingKnownBits << missing));
+                context.pendingReceivedBits = 0;
+                context.pendingKnownBits = 0;
+                context.pendingCount = 0;
+            }
+            
+            traceback(context, context.undecidedSteps);
+        }
+        
+    };
+    
+    // Definition for the static member PuncturedConvolutionalDecoderEngine::polynomials_
+    template<typename TPuncturingMatrix, uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr TShiftReg PuncturedConvolutionalDecoderEngine<TPuncturingMatrix, Depth, ConstraintLength, TShiftReg, Polynomials...>::polynomials_[sizeof...(Polynomials)];
+    
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    using ConvolutionalDecoderEngine = PuncturedConvolutionalDecoderEngine<Sequence<uint8_t, 1>, Depth, ConstraintLength, TShiftReg, Polynomials...>;
+
+}
+
+#endif // FECMAGIC_CONVOLUTIONAL_DECODER_ENGINE_H
@@ -43,6 +43,50 @@
 
 namespace fecmagic {
 
+    /**
+     * @brief Link quality statistics gathered by the convolutional decoder.
+     *
+     * The decoder updates these incrementally while it decodes, so the caller
+     * gets an estimate of the channel bit error rate without a second pass.
+     * Two estimates are provided:
+     * - the growth of the lowest path metric, which is the number of bits the
+     *   most likely path had to disagree with (this is always available)
+     * - the number of mismatches found by re-encoding the decoded output and
+     *   comparing it to the received bits (this needs to be enabled)
+     */
+    struct ConvolutionalDecoderStatistics final {
+        
+        // Number of decoder steps taken
+        uint64_t steps = 0;
+        
+        // Number of received (non-punctured) bits
+        uint64_t receivedBits = 0;
+        
+        // Bit errors estimated from the growth of the lowest path metric
+        uint64_t pathMetricErrors = 0;
+        
+        // Number of received bits that were checked by re-encoding
+        uint64_t reencodedBits = 0;
+        
+        // Number of received bits that differ from the re-encoded output
+        uint64_t reencodingErrors = 0;
+        
+        /**
+         * @brief Returns the channel bit error rate estimated from the path metrics.
+         */
+        inline double pathMetricBitErrorRate() const {
+            return (receivedBits == 0) ? 0.0 : (static_cast<double>(pathMetricErrors) / static_cast<double>(receivedBits));
+        }
+        
+        /**
+         * @brief Returns the channel bit error rate estimated by re-encoding the output.
+         */
+        inline double reencodingBitErrorRate() const {
+            return (reencodedBits == 0) ? 0.0 : (static_cast<double>(reencodingErrors) / static_cast<double>(reencodedBits));
+        }
+        
+    };
+
     /**
      * @brief Decoder that can decode convolutional code.
      * 
@@ -133,6 +177,11 @@ namespace fecmagic {
             // The state with the lowest error metric found so far in this step.
             State *lowestErrorState = nullptr;
             
+            // The received bits and their mask that lead to this step,
+            // kept so that the decoded output can be re-encoded and compared.
+            TShiftReg receivedBits = 0;
+            TShiftReg knownBits = 0;
+            
             inline explicit Step() {
                 this->reset();
             }
@@ -216,6 +265,245 @@ namespace fecmagic {
         // Output position
         size_t outAddr;
         uint32_t outBitPos;
+        
+        // Link quality statistics
+        ConvolutionalDecoderStatistics statistics_;
+        
+        // Whether the decoded output is re-encoded for the statistics
+        bool reencodingCheck_ = false;
+        
+        // Shift register of the encoder that re-encodes the decoded output
+        TShiftReg reencoderShiftReg;
+        
+        // Incomplete symbol that is carried between calls to decodeBits()
+        TShiftReg pendingReceivedBits = 0;
+        TShiftReg pendingKnownBits = 0;
+        uint32_t pendingCount = 0;
+        
+        // Incomplete output byte that is carried between calls to decodeBits()
+        uint8_t sinkPartialByte = 0;
+        
+        // Puts a decoded bit to the output, and re-encodes it if necessary
+        inline void putOutputBit(uint8_t pib, const Step &step) {
+            assert((pib & 1) == pib);
+            
+            if (outBitPos == 7) {
+                // Set current output byte to zero, so that Valgrind and other
+                // memory check tools don't complain about it.
+                output[outAddr] = 0;
+            }
+            
+            DEBUG_PRINT("<--- OUTADDR=" << outAddr << " pib_out=" << ((uint32_t)pib));
+            output[outAddr] |= (pib << outBitPos);
+            
+            // Advance output bit position
+            if (outBitPos == 0) {
+                outAddr++;
+                outBitPos = 7;
+            }
+            else {
+                outBitPos--;
+            }
+            
+            // Compare the re-encoded output with what was actually received
+            if (reencodingCheck_) {
+                reencoderShiftReg = (reencoderShiftReg >> 1) | (pib << (ConstraintLength - 1));
+                TShiftReg reencoded = getEncoderOutput(reencoderShiftReg);
+                statistics_.reencodedBits += computePopcount(step.knownBits);
+                statistics_.reencodingErrors += computeHammingDistance(reencoded & step.knownBits, step.receivedBits);
+            }
+        }
+        
+        // Takes a step in the trellis with the given received bits
+        inline void decodeStep(TShiftReg receivedBits, TShiftReg knownBits) {
+            uint32_t nextWindowPos;
+            uint32_t afterNextWindowPos;
+            
+            // Calculate next position in the window
+            if (windowPos == (Depth - 1)) {
+                nextWindowPos = 0;
+            }
+            else {
+                nextWindowPos = windowPos + 1;
+            }
+            
+            // Remember what was received, for re-encoding the output
+            window[nextWindowPos].receivedBits = receivedBits;
+            window[nextWindowPos].knownBits = knownBits;
+            
+            // Go through all possible states at current step
+            for (TShiftReg i = 0; i <  Step::possibleStateCount; i++) {
+                // Current state
+                State &currentState = window[windowPos].states[i];
+                
+                // If accumulated metric is infinity, we don't bother with this state
+                if (currentState.accumulatedErrorMetric == maxErrorMetric) {
+                    continue;
+                }
+#ifdef CONVOLUTIONAL_DECODER_DEBUG
+                currentState.state = i;
+#endif
+                
+                // Calculate appropriate error metric for possible input bits
+                calculateErrorMetricForInput(currentState, window[nextWindowPos], i, receivedBits, knownBits, 0);
+                calculateErrorMetricForInput(currentState, window[nextWindowPos], i, receivedBits, knownBits, 1);
+            }
+            
+            
+            if (currentStepCount > (Depth - 2)) {
+                // Get output bits, if any, by tracing back
+                const State *stateWithOutput = window[nextWindowPos].lowestErrorState;
+                for (uint32_t i = 0; i < (Depth - 1); i++) {
+                    assert(stateWithOutput->previous != nullptr);
+                    stateWithOutput = stateWithOutput->previous;
+                }
+                
+                // Get output bit and put it to its correct place,
+                // the state that was traced back belongs to the step after the next one
+                uint8_t pib = stateWithOutput->presumedInputBit;
+                putOutputBit(pib, window[(nextWindowPos == (Depth - 1)) ? 0 : (nextWindowPos + 1)]);
+            }
+            
+            // Update statistics: the lowest path metric grows by
+            // the number of bits that the best path disagrees with
+            TShiftReg previousLowestMetric = window[windowPos].lowestErrorMetric;
+            TShiftReg nextLowestMetric = window[nextWindowPos].lowestErrorMetric;
+            statistics_.steps++;
+            statistics_.receivedBits += computePopcount(knownBits);
+            if (nextLowestMetric != maxErrorMetric && nextLowestMetric >= previousLowestMetric) {
+                statistics_.pathMetricErrors += (nextLowestMetric - previousLowestMetric);
+            }
+            
+            // Get the window position after the next one
+            if (nextWindowPos == (Depth - 1)) {
+                afterNextWindowPos = 0;
+            }
+            else {
+                afterNextWindowPos = nextWindowPos + 1;
+            }
+            
+            // Reset the step after the next one, so that it can start fresh
+            window[afterNextWindowPos].reset();
+            
+            // Advance window position
+            windowPos = nextWindowPos;
+            
+            // Increment step counter
+            currentStepCount ++;
+        }
+        
+        // Decodes the given input bits, optionally taking an erasure bitmap into account.
+        // When CarryPartial is set, an incomplete symbol at the end of the input is kept
+        // for the next call, otherwise a step is taken with it right away.
+        // The afterStep function is called after each step.
+        template<bool UseErasures, bool CarryPartial, typename TAfterStep>
+        void decodeImpl(const void *input, size_t bitOffset, size_t bitCount, const void *erasures, TAfterStep afterStep) {
+            // Check parameters
+            if (bitCount == 0) {
+                return;
+            }
+            
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            const uint8_t *erasureBytes = reinterpret_cast<const uint8_t*>(erasures);
+            assert(inputBytes != nullptr);
+            assert(!UseErasures || erasureBytes != nullptr);
+            assert(output != nullptr);
+            
+            DEBUG_PRINT("depth=" << (uint32_t)Depth << ", possibleStateCount=" << (uint32_t)Step::possibleStateCount);
+            
+            // Input position
+            size_t pos = bitOffset;
+            size_t end = bitOffset + bitCount;
+            
+            // The incomplete symbol from the previous call, if any
+            TShiftReg receivedBits = pendingReceivedBits;
+            TShiftReg knownBits = pendingKnownBits;
+            uint32_t count = pendingCount;
+            
+            while (pos < end) {
+                // Get necessary number of input bits, one by one.
+                // Punctured bits don't need any input.
+                while (count < outputCount_) {
+                    bool punctured = (0 == TPuncturingMatrix::numbers[puncturingMatrix.phase()]);
+                    if (!punctured && pos == end) {
+                        break;
+                    }
+                    
+                    puncturingMatrix.next();
+                    receivedBits <<= 1;
+                    knownBits <<= 1;
+                    count++;
+                    
+                    if (punctured) {
+                        continue;
+                    }
+                    
+                    // Erased bits are treated the same way as punctured ones,
+                    // so they don't contribute to the error metric.
+                    uint8_t known = 1;
+                    if (UseErasures) {
+                        known = ((erasureBytes[pos / 8] >> (7 - pos % 8)) & 1) ^ 1;
+                    }
+                    
+                    knownBits |= known;
+                    receivedBits |= ((inputBytes[pos / 8] >> (7 - pos % 8)) & known);
+                    pos++;
+                }
+                
+                if (CarryPartial && count < outputCount_) {
+                    // Wait for the rest of the symbol
+                    break;
+                }
+                
+                decodeStep(receivedBits, knownBits);
+                receivedBits = 0;
+                knownBits = 0;
+                count = 0;
+                afterStep();
+            }
+            
+            pendingReceivedBits = receivedBits;
+            pendingKnownBits = knownBits;
+            pendingCount = count;
+        }
+        
+        // Number of steps between writing to a sink
+        constexpr static size_t sinkChunkSteps_ = 512;
+        
+        // Size of the buffer used before writing to a sink, enough for a chunk or a flush
+        constexpr static size_t sinkBufferSize_ = (sinkChunkSteps_ + Depth) / 8 + 2;
+        
+        // Writes the complete output bytes to the sink and keeps the incomplete one
+        template<typename TSink>
+        inline void drainToSink(TSink &sink) {
+            if (outAddr > 0) {
+                sink.write(output, outAddr);
+                if (outBitPos != 7) {
+                    output[0] = output[outAddr];
+                }
+                outAddr = 0;
+            }
+        }
+        
+        template<bool UseErasures, typename TSink>
+        void decodeBitsImpl(const void *input, size_t bitOffset, size_t bitCount, const void *erasures, TSink &sink) {
+            // Use a small buffer on the stack as the output
+            uint8_t buffer[sinkBufferSize_];
+            uint8_t *previousOutput = output;
+            output = buffer;
+            outAddr = 0;
+            buffer[0] = sinkPartialByte;
+            
+            decodeImpl<UseErasures, true>(input, bitOffset, bitCount, erasures, [this, &sink]() {
+                if (this->outAddr >= sinkChunkSteps_ / 8) {
+                    this->drainToSink(sink);
+                }
+            });
+            drainToSink(sink);
+            
+            sinkPartialByte = buffer[0];
+            output = previousOutput;
+        }
     
     public:
         
@@ -260,6 +548,13 @@ namespace fecmagic {
             this->currentStepCount = std::move(other.currentStepCount);
             this->outAddr = std::move(other.outAddr);
             this->outBitPos = std::move(other.outBitPos);
+            this->statistics_ = std::move(other.statistics_);
+            this->reencodingCheck_ = std::move(other.reencodingCheck_);
+            this->reencoderShiftReg = std::move(other.reencoderShiftReg);
+            this->pendingReceivedBits = std::move(other.pendingReceivedBits);
+            this->pendingKnownBits = std::move(other.pendingKnownBits);
+            this->pendingCount = std::move(other.pendingCount);
+            this->sinkPartialByte = std::move(other.sinkPartialByte);
         };
         
         /**
@@ -286,10 +581,69 @@ namespace fecmagic {
             outAddr = 0;
             outBitPos = 7;
             
+            // The re-encoder also starts at the 0 state
+            reencoderShiftReg = 0;
+            
+            // Nothing is carried over
+            pendingReceivedBits = 0;
+            pendingKnownBits = 0;
+            pendingCount = 0;
+            sinkPartialByte = 0;
+            
             // Reset the puncturing matrix
             puncturingMatrix.reset();
         }
         
+        /**
+         * @brief Resets the decoder for starting in the middle of a stream, and sets the given output.
+         *
+         * Unlike reset(), this doesn't assume that the encoder is in the 0 state: every
+         * state starts with the same metric. The first few decoded bits are less reliable,
+         * until the path metrics converge (typically after a few constraint lengths).
+         */
+        void resetToUnknownState(void *output) {
+            this->reset(output);
+            
+            for (TShiftReg i = 0; i < Step::possibleStateCount; i++) {
+                window[0].states[i].accumulatedErrorMetric = 0;
+            }
+        }
+        
+        /**
+         * @brief Returns the link quality statistics gathered so far.
+         *
+         * The statistics are kept across calls to reset(), so that they can
+         * cover any number of frames. Use resetStatistics() to clear them.
+         */
+        inline const ConvolutionalDecoderStatistics &statistics() const {
+            return statistics_;
+        }
+        
+        /**
+         * @brief Clears the link quality statistics.
+         */
+        inline void resetStatistics() {
+            statistics_ = ConvolutionalDecoderStatistics();
+        }
+        
+        /**
+         * @brief Enables or disables re-encoding the decoded output for the statistics.
+         *
+         * When enabled, every decoded bit is encoded again and the result is compared
+         * to the received bits, which gives a more accurate error estimate than the
+         * path metrics, at the cost of a few more operations per decoded bit.
+         */
+        inline void setReencodingCheckEnabled(bool enabled) {
+            reencodingCheck_ = enabled;
+        }
+        
+        /**
+         * @brief Tells whether the decoded output is re-encoded for the statistics.
+         */
+        inline bool isReencodingCheckEnabled() const {
+            return reencodingCheck_;
+        }
+        
         /**
          * @brief Returns the size of the output you need to allocate for a given input.
          *
@@ -330,131 +684,49 @@ namespace fecmagic {
          * This method is suitable for streaming.
          */
         void decode(const void *input, size_t inputSize) {
-            // Check parameters
-            if (inputSize == 0) {
-                return;
-            }
-            
-            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
-            assert(inputBytes != nullptr);
-            assert(output != nullptr);
-            
-            DEBUG_PRINT("depth=" << (uint32_t)Depth << ", possibleStateCount=" << (uint32_t)Step::possibleStateCount);
+            decodeImpl<false, false>(input, 0, inputSize * 8, nullptr, []() {});
+        }
         
-            // Input position
-            size_t inAddr = 0;
-            uint32_t inBitPos = 7;
-            
-            while (inAddr < inputSize) {
-                uint32_t nextWindowPos;
-                uint32_t afterNextWindowPos;
-                
-                // The actual received input bits
-                TShiftReg receivedBits = 0;
-                // Bit mask, 0=punctured, 1=known bit
-                TShiftReg knownBits = 0;
-                
-                // Get necessary number of input bits, one by one.
-                // NOTE: We need to check inAddr vs. inputSize here again,
-                //       because if the output count is odd, inAddr might go
-                //       out of range.
-                for (uint32_t o = 0; o < outputCount_ && inAddr < inputSize; o++) {
-                    // Read current input bit
-                    receivedBits <<= 1;
-                    // Shift the known bits
-                    knownBits <<= 1;
-                    
-                    if (0 == puncturingMatrix.next()) {
-                        continue;
-                    }
-                    
-                    knownBits |= 1;
-                    receivedBits |= ((inputBytes[inAddr] >> inBitPos) & 1);
-                    
-                    // Advance input bit position
-                    if (inBitPos == 0) {
-                        inAddr++;
-                        inBitPos = 7;
-                    }
-                    else {
-                        inBitPos--;
-                    }
-                }
-                
-                // Calculate next position in the window
-                if (windowPos == (Depth - 1)) {
-                    nextWindowPos = 0;
-                }
-                else {
-                    nextWindowPos = windowPos + 1;
-                }
-                
-                // Go through all possible states at current step
-                for (TShiftReg i = 0; i <  Step::possibleStateCount; i++) {
-                    // Current state
-                    State &currentState = window[windowPos].states[i];
-                    
-                    // If accumulated metric is infinity, we don't bother with this state
-                    if (currentState.accumulatedErrorMetric == maxErrorMetric) {
-                        continue;
-                    }
-#ifdef CONVOLUTIONAL_DECODER_DEBUG
-                    currentState.state = i;
-#endif
-                    
-                    // Calculate appropriate error metric for possible input bits
-                    calculateErrorMetricForInput(currentState, window[nextWindowPos], i, receivedBits, knownBits, 0);
-                    calculateErrorMetricForInput(currentState, window[nextWindowPos], i, receivedBits, knownBits, 1);
-                }
-                
-                
-                if (currentStepCount > (Depth - 2)) {
-                    // Get output bits, if any, by tracing back
-                    const State *stateWithOutput = window[nextWindowPos].lowestErrorState;
-                    for (uint32_t i = 0; i < (Depth - 1); i++) {
-                        assert(stateWithOutput->previous != nullptr);
-                        stateWithOutput = stateWithOutput->previous;
-                    }
-                    
-                    // Get output bit and put it to its correct place
-                    uint8_t pib = stateWithOutput->presumedInputBit;
-                    assert((pib & 1) == pib);
-                    
-                    if (outBitPos == 7) {
-                        // Set current output byte to zero, so that Valgrind and other
-                        // memory check tools don't complain about it.
-                        output[outAddr] = 0;
-                    }
-                    DEBUG_PRINT("<--- OUTADDR=" << outAddr << " pib_out=" << ((uint32_t)pib) << " state=" << BinaryPrint<uint8_t>(stateWithOutput->state));
-                    output[outAddr] |= (pib << outBitPos);
-                    
-                    // Advance output bit position
-                    if (outBitPos == 0) {
-                        outAddr++;
-                        outBitPos = 7;
-                    }
-                    else {
-                        outBitPos--;
-                    }
-                }
-                
-                // Get the window position after the next one
-                if (nextWindowPos == (Depth - 1)) {
-                    afterNextWindowPos = 0;
-                }
-                else {
-                    afterNextWindowPos = nextWindowPos + 1;
-                }
-                
-                // Reset the step after the next one, so that it can start fresh
-                window[afterNextWindowPos].reset();
-                
-                // Advance window position
-                windowPos = nextWindowPos;
-                
-                // Increment step counter
-                currentStepCount ++;
-            }
+        /**
+         * @brief Decodes a given block, in which some bits are known to be erased.
+         *
+         * Works the same way as the other decode() method, but also takes an erasure
+         * bitmap that has the same layout as the input: each set bit in the bitmap
+         * marks the corresponding input bit as erased (for example lost or blanked
+         * by interference). Erased bits are treated like punctured bits, so they don't
+         * contribute to the error metric of any path.
+         *
+         * This method is suitable for streaming.
+         */
+        void decode(const void *input, size_t inputSize, const void *erasures) {
+            decodeImpl<true, false>(input, 0, inputSize * 8, erasures, []() {});
+        }
+        
+        /**
+         * @brief Decodes the given bits and writes the output to a sink.
+         *
+         * The input starts at the given bit offset (counting from the MSB of the first
+         * byte) and can be of any number of bits: an incomplete symbol at the end is
+         * kept until the next call. The output is written to the sink (see outputsink.h)
+         * in complete bytes, and an incomplete byte is carried over to the next call.
+         * Call flushBits() at the end of the stream.
+         *
+         * This method is suitable for streaming, but don't mix it with decode()
+         * between two calls to reset().
+         */
+        template<typename TSink>
+        void decodeBits(const void *input, size_t bitOffset, size_t bitCount, TSink &sink) {
+            decodeBitsImpl<false>(input, bitOffset, bitCount, nullptr, sink);
+        }
+        
+        /**
+         * @brief Decodes the given bits, in which some bits are known to be erased, and writes the output to a sink.
+         *
+         * The erasure bitmap has the same layout as the input, including the bit offset.
+         */
+        template<typename TSink>
+        void decodeBits(const void *input, size_t bitOffset, size_t bitCount, const void *erasures, TSink &sink) {
+            decodeBitsImpl<true>(input, bitOffset, bitCount, erasures, sink);
         }
         
         void flush() {
@@ -486,27 +758,48 @@ namespace fecmagic {
             
             // Put the remaining bits to the output in the correct order
             for (; trackbackIndex < tracebackDepth; trackbackIndex++) {
-                uint8_t pib = remainingOutputBits[trackbackIndex];
-                assert((pib & 1) == pib);
-                
-                if (outBitPos == 7) {
-                    // Set current output byte to zero, so that Valgrind and other
-                    // memory check tools don't complain about it.
-                    output[outAddr] = 0;
-                }
-                
-                DEBUG_PRINT("<--- pib_out=" << ((uint32_t)pib));
-                output[outAddr] |= (pib << outBitPos);
-                
-                // Advance output bit position
-                if (outBitPos == 0) {
-                    outAddr++;
-                    outBitPos = 7;
-                }
-                else {
-                    outBitPos--;
+                // Window position of the step that this bit belongs to
+                uint32_t stepPos = (windowPos + Depth - (tracebackDepth - 1 - trackbackIndex)) % Depth;
+                putOutputBit(remainingOutputBits[trackbackIndex], window[stepPos]);
+            }
+        }
+        
+        /**
+         * @brief Flushes the decoder and writes the output to a sink.
+         *
+         * An incomplete symbol is completed with unknown bits, and the last
+         * incomplete output byte is written padded with zeroes.
+         */
+        template<typename TSink>
+        void flushBits(TSink &sink) {
+            uint8_t buffer[sinkBufferSize_];
+            uint8_t *previousOutput = output;
+            output = buffer;
+            outAddr = 0;
+            buffer[0] = sinkPartialByte;
+            
+            if (pendingCount > 0) {
+                while (pendingCount < outputCount_) {
+                    puncturingMatrix.next();
+                    pendingReceivedBits <<= 1;
+                    pendingKnownBits <<= 1;
+                    pendingCount++;
                 }
+                decodeStep(pendingReceivedBits, pendingKnownBits);
+                pendingReceivedBits = 0;
+                pendingKnownBits = 0;
+                pendingCount = 0;
+            }
+            
+            flush();
+            if (outBitPos != 7) {
+                outAddr++;
+                outBitPos = 7;
             }
+            drainToSink(sink);
+            
+            sinkPartialByte = 0;
+            output = previousOutput;
         }
     
     
@@ -515,6 +808,10 @@ namespace fecmagic {
     // Definition for the static member PuncturedConvolutionalDecoder::polynomials_
     template<typename TPuncturingMatrix, uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
     constexpr TShiftReg PuncturedConvolutionalDecoder<TPuncturingMatrix, Depth, ConstraintLength, TShiftReg, Polynomials...>::polynomials_[sizeof...(Polynomials)];
+    
+    // Definition for the static member PuncturedConvolutionalDecoder::sinkChunkSteps_
+    template<typename TPuncturingMatrix, uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr size_t PuncturedConvolutionalDecoder<TPuncturingMatrix, Depth, ConstraintLength, TShiftReg, Polynomials...>::sinkChunkSteps_;
 
     template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
     using ConvolutionalDecoder = PuncturedConvolutionalDecoder<Sequence<uint8_t, 1>, Depth, ConstraintLength, TShiftReg, Polynomials...>;
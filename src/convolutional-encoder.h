@@ -29,9 +29,11 @@
 #include <cstddef>
 #include <limits>
 #include <utility>
+#include <algorithm>
 
 #include "fecmagic-global.h"
 #include "sequence.h"
+#include "puncturing.h"
 
 //#define CONVOLUTIONAL_ENCODER_DEBUG
 #ifdef CONVOLUTIONAL_ENCODER_DEBUG
@@ -85,7 +87,31 @@ namespace fecmagic {
         // The shift register
         TShiftReg shiftReg = 0;
         
-        inline void produceOutput() {
+        // Incomplete output byte that is carried between calls to encodeBits()
+        uint8_t sinkPartialByte = 0;
+        
+        // Puts the next output bit into the output bytes
+        inline void putBit(uint8_t bit) {
+            if (outBitPos == 7) {
+                DEBUG_PRINT("set " << outAddr << " byte to 0");
+                output[outAddr] = 0;
+            }
+            
+            // Put the output bit to its correct place
+            output[outAddr] |= (bit << outBitPos);
+            
+            // Advance output bit position
+            if (outBitPos == 0) {
+                outAddr++;
+                outBitPos = 7;
+            }
+            else {
+                outBitPos--;
+            }
+        }
+        
+        template<typename TOutputBit>
+        inline void produceOutput(TOutputBit outputBit) {
             // Compute outputs from the current state of the encoder
             for (uint32_t o = 0; o < outputCount_; o++) {
                 // Don't output when the next item in the puncturing matrix is zero
@@ -94,24 +120,193 @@ namespace fecmagic {
                     continue;
                 }
                 
-                if (outBitPos == 7) {
-                    DEBUG_PRINT("set " << outAddr << " byte to 0");
-                    output[outAddr] = 0;
-                }
-                
                 DEBUG_PRINT(outAddr << "/" << outBitPos << " shiftReg=" << BinaryPrint<TShiftReg>(shiftReg));
-                // Compute output and put it to its correct place
-                output[outAddr] |= (::fecmagic::computeParity(polynomials_[o] & shiftReg) << outBitPos);
+                // Compute output and pass it on
+                outputBit(::fecmagic::computeParity(polynomials_[o] & shiftReg));
+            }
+        }
+        
+        template<typename TOutputBit>
+        void encodeImpl(const void *input, size_t bitOffset, size_t bitCount, TOutputBit outputBit) {
+            if (bitCount == 0) {
+                return;
+            }
+            
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            assert(inputBytes != nullptr);
+            
+            // Go through each input bit
+            for (size_t i = bitOffset; i < bitOffset + bitCount; i++) {
+                // Shift the register right
+                shiftReg >>= 1;
                 
-                // Advance output bit position
-                if (outBitPos == 0) {
-                    outAddr++;
-                    outBitPos = 7;
+                // Shift the next input bit into the register
+                shiftReg |= (((inputBytes[i / 8] >> (7 - i % 8)) & 1) << (ConstraintLength - 1));
+                
+                // Produce output
+                produceOutput(outputBit);
+            }
+        }
+        
+        template<typename TOutputBit>
+        void flushImpl(TOutputBit outputBit) {
+            for (uint32_t i = 0; i < ConstraintLength; i++) {
+                // Shift the register right
+                shiftReg >>= 1;
+                
+                // Produce output
+                produceOutput(outputBit);
+            }
+        }
+        
+        // The word-parallel encoder is used when the outputs of a byte fit into a 64-bit word
+        static inline bool isWordParallel() {
+            return (outputCount_ <= 8) && (ConstraintLength <= 64);
+        }
+        
+        // Number of input words that are encoded at once before puncturing
+        constexpr static size_t stagingWordCount_ = 32;
+        
+        // Number of input bytes that are encoded at once before writing to a sink
+        constexpr static size_t sinkChunkSize_ = 64;
+        
+        // Size of the buffer used before writing to a sink, enough for a chunk or a flush
+        constexpr static size_t sinkBufferSize_ = ((sinkChunkSize_ > ConstraintLength) ? sinkChunkSize_ : ConstraintLength) * outputCount_ + 2;
+        
+        // Writes the complete output bytes to the sink and keeps the incomplete one
+        template<typename TSink>
+        inline void drainToSink(TSink &sink) {
+            if (outAddr > 0) {
+                sink.write(output, outAddr);
+                if (outBitPos != 7) {
+                    output[0] = output[outAddr];
                 }
-                else {
-                    outBitPos--;
+                outAddr = 0;
+            }
+        }
+        
+        // Returns the puncturing stage for the puncturing matrix, which is created when it is first needed
+        static inline const PuncturingStage &puncturingStage() {
+            static const PuncturingStage stage(TPuncturingMatrix::numbers, TPuncturingMatrix::count);
+            return stage;
+        }
+        
+        // Table that spreads the bits of a byte so that the outputs can be interleaved
+        struct SpreadTable final {
+            uint64_t spread[256];
+            
+            explicit SpreadTable() {
+                for (uint32_t b = 0; b < 256; b++) {
+                    spread[b] = 0;
+                    for (uint32_t i = 0; i < 8; i++) {
+                        spread[b] |= static_cast<uint64_t>((b >> (7 - i)) & 1) << (8 * outputCount_ - 1 - i * outputCount_);
+                    }
                 }
             }
+        };
+        
+        // Returns the spread table, which is created when it is first needed
+        static inline const SpreadTable &spreadTable() {
+            static const SpreadTable t;
+            return t;
+        }
+        
+        // Carry-less multiplication using shifts and XORs
+        struct ShiftXorMultiply final {
+            static inline void multiply(uint64_t a, uint64_t b, uint64_t &lo, uint64_t &hi) {
+                lo = 0;
+                hi = 0;
+                for (uint32_t j = 0; j < ConstraintLength; j++) {
+                    if ((b >> j) & 1) {
+                        lo ^= a << j;
+                        hi ^= (j == 0) ? 0 : (a >> (64 - j));
+                    }
+                }
+            }
+        };
+        
+#ifdef COMPILE_PCLMUL_CODE
+        // Carry-less multiplication using the PCLMULQDQ instruction
+        struct PclmulMultiply final {
+            PCLMUL_FUNCTION static inline void multiply(uint64_t a, uint64_t b, uint64_t &lo, uint64_t &hi) {
+                __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(static_cast<long long>(a)), _mm_cvtsi64_si128(static_cast<long long>(b)), 0);
+                lo = static_cast<uint64_t>(_mm_cvtsi128_si64(r));
+                hi = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(r, r)));
+            }
+        };
+#endif
+        
+        // Encodes 64 input bits at a time.
+        // The input bits (MSB first) of a word are treated as a polynomial over GF(2),
+        // where earlier bits have higher degree. Multiplying that with a polynomial of
+        // the code gives its output for each input bit (shifted by ConstraintLength - 1),
+        // and the low part of the previous word's product carries over into the next word.
+        template<typename TMultiply>
+        static inline void encodeWordsImpl(const uint8_t *input, size_t wordCount, uint8_t *out, TShiftReg &shiftReg) {
+            const SpreadTable &t = spreadTable();
+            uint64_t carry[outputCount_];
+            uint64_t results[outputCount_];
+            uint64_t hi;
+            
+            // Previous input bits, last one in the lowest bit
+            uint64_t previous = 0;
+            for (uint32_t i = 0; i < ConstraintLength; i++) {
+                previous |= static_cast<uint64_t>((shiftReg >> (ConstraintLength - 1 - i)) & 1) << i;
+            }
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                TMultiply::multiply(previous, polynomials_[o], carry[o], hi);
+            }
+            
+            for (size_t w = 0; w < wordCount; w++) {
+                // Load the next 64 input bits
+                uint64_t word = 0;
+                for (uint32_t i = 0; i < 8; i++) {
+                    word = (word << 8) | input[w * 8 + i];
+                }
+                
+                // Compute the outputs of each polynomial
+                for (uint32_t o = 0; o < outputCount_; o++) {
+                    uint64_t lo;
+                    TMultiply::multiply(word, polynomials_[o], lo, hi);
+                    results[o] = (lo >> (ConstraintLength - 1)) ^ ((hi ^ carry[o]) << (65 - ConstraintLength));
+                    carry[o] = lo;
+                }
+                
+                // Interleave the outputs
+                for (uint32_t i = 0; i < 8; i++) {
+                    uint64_t bits = 0;
+                    for (uint32_t o = 0; o < outputCount_; o++) {
+                        bits |= t.spread[(results[o] >> (56 - 8 * i)) & 0xff] >> o;
+                    }
+                    for (uint32_t j = 0; j < outputCount_; j++) {
+                        *(out++) = static_cast<uint8_t>(bits >> (8 * (outputCount_ - 1 - j)));
+                    }
+                }
+                
+                previous = word;
+            }
+            
+            // Put the last input bits into the shift register
+            shiftReg = 0;
+            for (uint32_t i = 0; i < ConstraintLength; i++) {
+                shiftReg |= static_cast<TShiftReg>(((previous >> i) & 1) << (ConstraintLength - 1 - i));
+            }
+        }
+        
+#ifdef COMPILE_PCLMUL_CODE
+        PCLMUL_FUNCTION static void encodeWordsPclmul(const uint8_t *input, size_t wordCount, uint8_t *out, TShiftReg &shiftReg) {
+            encodeWordsImpl<PclmulMultiply>(input, wordCount, out, shiftReg);
+        }
+#endif
+        
+        static void encodeWords(const uint8_t *input, size_t wordCount, uint8_t *out, TShiftReg &shiftReg) {
+#ifdef COMPILE_PCLMUL_CODE
+            if (PCLMUL_SUPPORTED) {
+                encodeWordsPclmul(input, wordCount, out, shiftReg);
+                return;
+            }
+#endif
+            encodeWordsImpl<ShiftXorMultiply>(input, wordCount, out, shiftReg);
         }
         
     public:
@@ -148,6 +343,7 @@ namespace fecmagic {
             this->shiftReg = std::move(other.shiftReg);
             this->outAddr = std::move(other.outAddr);
             this->outBitPos = std::move(other.outBitPos);
+            this->sinkPartialByte = std::move(other.sinkPartialByte);
         };
         
         /**
@@ -160,27 +356,91 @@ namespace fecmagic {
             this->shiftReg = 0;
             this->outAddr = 0;
             this->outBitPos = 7;
+            this->sinkPartialByte = 0;
         }
         
         /**
-         * @brief Returns the size of the output you need to allocate for a given input.
+         * @brief Resets the encoder to continue encoding from the middle of the input.
          *
-         * Output size: give space to encoded bits and
-         * after that, allow the encoder to be flushed.
+         * Sets up the encoder as if the first inputOffset bytes of the input had
+         * already been encoded into the given output: the shift register is seeded with
+         * the preceding input bits, and the puncturing phase and the output position
+         * are computed. After this, encode() can be called with the input starting
+         * at inputOffset, and gives exactly the same output as a single encoder would.
+         *
+         * This makes it possible to encode parts of a large input independently,
+         * see ParallelEncoder.
          */
-        static inline size_t calculateOutputSize(size_t inputSize) {
+        void resetAt(void *output, const void *input, size_t inputOffset) {
+            DEBUG_PRINT(::std::endl << "resetting encoder at " << inputOffset);
+            reset(output);
+            
+            // The last input bits are in the shift register
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            size_t bitCount = inputOffset * 8;
+            size_t historyBits = ::std::min(bitCount, static_cast<size_t>(ConstraintLength));
+            for (size_t i = bitCount - historyBits; i < bitCount; i++) {
+                shiftReg >>= 1;
+                shiftReg |= static_cast<TShiftReg>(static_cast<TShiftReg>((inputBytes[i / 8] >> (7 - i % 8)) & 1) << (ConstraintLength - 1));
+            }
+            
+            // Output bits produced so far
+            size_t outputBits = bitCount * outputCount_;
+            puncturingMatrix.setPhase(outputBits % TPuncturingMatrix::count);
+            size_t puncturedOutputBits = calculatePuncturedBitCount(outputBits);
+            outAddr = puncturedOutputBits / 8;
+            outBitPos = 7 - (puncturedOutputBits % 8);
+        }
+        
+        /**
+         * @brief Returns the number of input bytes after which the puncturing matrix
+         * starts over at a byte boundary of the output.
+         */
+        static inline size_t puncturingPeriod() {
+            return TPuncturingMatrix::count;
+        }
+        
+        /**
+         * @brief Returns the number of bits that remain of the given number of output bits after puncturing.
+         */
+        static inline size_t calculatePuncturedBitCount(size_t outputBits) {
+            // Whole periods of the puncturing matrix, and what remains
+            size_t puncturedOutputBits = (outputBits / TPuncturingMatrix::count) * TPuncturingMatrix::nonZeroes();
+            for (size_t i = 0; i < outputBits % TPuncturingMatrix::count; i++) {
+                if (0 != TPuncturingMatrix::numbers[i]) {
+                    puncturedOutputBits += 1;
+                }
+            }
+            return puncturedOutputBits;
+        }
+        
+        /**
+         * @brief Returns the number of output bits (or symbols) for a given input.
+         *
+         * This is the number of encoded bits, including the bits produced
+         * by flushing the encoder, after puncturing.
+         */
+        static inline size_t calculateSymbolCount(size_t inputSize) {
             // Calculate non-punctured output bits
             size_t outputBits = ((inputSize * 8) + ConstraintLength) * outputCount_;
             DEBUG_PRINT("inputsize=" << inputSize << ", constraintlength=" << ConstraintLength << ", non-punctured output bit count: " << outputBits);
             
             // Take puncturing into account
-            size_t t = outputBits * TPuncturingMatrix::nonZeroes();
-            size_t puncturedOutputBits = t / TPuncturingMatrix::count;
-            if (0 != (t % TPuncturingMatrix::count)) {
-                puncturedOutputBits += 1;
-            }
+            size_t puncturedOutputBits = calculatePuncturedBitCount(outputBits);
             DEBUG_PRINT("punctured output bit count: " << puncturedOutputBits);
             
+            return puncturedOutputBits;
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         *
+         * Output size: give space to encoded bits and
+         * after that, allow the encoder to be flushed.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            size_t puncturedOutputBits = calculateSymbolCount(inputSize);
+            
             // Calculate byte count
             size_t outputSize = puncturedOutputBits / 8;
             if (0 != puncturedOutputBits % 8) {
@@ -202,42 +462,42 @@ namespace fecmagic {
          */
         void encode(const void *input, size_t inputSize) {
             DEBUG_PRINT("encode()ing");
-            
-            if (inputSize == 0) {
-                return;
-            }
-            
-            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
-            assert(inputBytes != nullptr);
             assert(output != nullptr);
             
-            // Input position
-            size_t inAddr = 0;
-            uint32_t inBitPos = 7;
-            
-            // Go through each input byte
-            while (inAddr < inputSize) {
-                // Shift the register right
-                shiftReg >>= 1;
+            // Encode whole 64-bit words at once when possible
+            if (isWordParallel() && inputSize >= 8) {
+                const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+                assert(inputBytes != nullptr);
                 
-                // If the input still has bytes, use them, otherwise just flush the register
-                if (inAddr < inputSize) {
-                    // Shift the next input bit into the register
-                    shiftReg |= (((inputBytes[inAddr] >> inBitPos) & 1) << (ConstraintLength - 1));
-                }
-                
-                // Produce output
-                produceOutput();
-                
-                // Advance input bit position
-                if (inBitPos == 0) {
-                    inAddr++;
-                    inBitPos = 7;
+                size_t wordCount = inputSize / 8;
+                if (TPuncturingMatrix::zeroes() == 0 && outBitPos == 7) {
+                    // Encode directly into the output
+                    encodeWords(inputBytes, wordCount, output + outAddr, shiftReg);
+                    outAddr += wordCount * 8 * outputCount_;
                 }
                 else {
-                    inBitPos--;
+                    // Encode into a staging buffer, then puncture (or just shift) it into the output
+                    uint8_t staging[stagingWordCount_ * 8 * outputCount_];
+                    size_t phase = puncturingMatrix.phase();
+                    size_t outBit = outAddr * 8 + (7 - outBitPos);
+                    
+                    for (size_t w = 0; w < wordCount; w += stagingWordCount_) {
+                        size_t n = ::std::min(stagingWordCount_, wordCount - w);
+                        encodeWords(inputBytes + w * 8, n, staging, shiftReg);
+                        outBit += puncturingStage().puncture(staging, n * 64 * outputCount_, output, outBit, phase);
+                    }
+                    
+                    puncturingMatrix.setPhase(phase);
+                    outAddr = outBit / 8;
+                    outBitPos = 7 - (outBit % 8);
                 }
+                input = inputBytes + wordCount * 8;
+                inputSize -= wordCount * 8;
             }
+            
+            encodeImpl(input, 0, inputSize * 8, [this](uint8_t bit) {
+                this->putBit(bit);
+            });
         }
         
         /**
@@ -246,13 +506,136 @@ namespace fecmagic {
         void flush() {
             DEBUG_PRINT("flush()ing");
             
-            for (uint32_t i = 0; i < ConstraintLength; i++) {
-                // Shift the register right
-                shiftReg >>= 1;
-                
-                // Produce output
-                produceOutput();
+            flushImpl([this](uint8_t bit) {
+                this->putBit(bit);
+            });
+        }
+        
+        /**
+         * @brief Encodes the given bits and writes the output to a sink.
+         *
+         * The input starts at the given bit offset (counting from the MSB of the first
+         * byte) and can be of any number of bits. The output is written to the sink
+         * (see outputsink.h) in complete bytes, and an incomplete byte is carried over to
+         * the next call, so there is no need to calculate the output size in advance.
+         * Call flushBits() at the end of the stream.
+         *
+         * This method is suitable for streaming, but don't mix it with encode()
+         * between two calls to reset().
+         */
+        template<typename TSink>
+        void encodeBits(const void *input, size_t bitOffset, size_t bitCount, TSink &sink) {
+            DEBUG_PRINT("encodeBits()ing");
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            
+            // Use a small buffer on the stack as the output
+            uint8_t buffer[sinkBufferSize_];
+            uint8_t *previousOutput = output;
+            output = buffer;
+            outAddr = 0;
+            buffer[0] = sinkPartialByte;
+            
+            auto outputBit = [this](uint8_t bit) {
+                this->putBit(bit);
+            };
+            
+            // Bits until the next byte boundary
+            size_t pos = bitOffset;
+            size_t end = bitOffset + bitCount;
+            size_t headEnd = ::std::min(end, (pos + 7) / 8 * 8);
+            encodeImpl(inputBytes, pos, headEnd - pos, outputBit);
+            drainToSink(sink);
+            pos = headEnd;
+            
+            // Whole bytes, a chunk at a time
+            while (end - pos >= 8) {
+                size_t n = ::std::min((end - pos) / 8, sinkChunkSize_);
+                encode(inputBytes + pos / 8, n);
+                drainToSink(sink);
+                pos += n * 8;
+            }
+            
+            // Remaining bits
+            encodeImpl(inputBytes, pos, end - pos, outputBit);
+            drainToSink(sink);
+            
+            sinkPartialByte = buffer[0];
+            output = previousOutput;
+        }
+        
+        /**
+         * @brief Flushes the encoder and writes the output to a sink.
+         *
+         * This also writes the last incomplete byte, padded with zeroes.
+         */
+        template<typename TSink>
+        void flushBits(TSink &sink) {
+            DEBUG_PRINT("flushBits()ing");
+            
+            uint8_t buffer[sinkBufferSize_];
+            uint8_t *previousOutput = output;
+            output = buffer;
+            outAddr = 0;
+            buffer[0] = sinkPartialByte;
+            
+            flush();
+            if (outBitPos != 7) {
+                outAddr++;
+                outBitPos = 7;
             }
+            drainToSink(sink);
+            
+            sinkPartialByte = 0;
+            output = previousOutput;
+        }
+        
+        /**
+         * @brief Encodes the given block into antipodal (BPSK) symbols.
+         *
+         * Instead of packing the encoded bits into bytes, every encoded bit is written
+         * as a symbol: 0 becomes +amplitude and 1 becomes -amplitude. TSymbol can be any
+         * signed type, such as int8_t, int16_t or float.
+         *
+         * For QPSK, consecutive symbols are the I and Q components of a complex sample,
+         * so the output can be used as interleaved I/Q pairs (use an amplitude of
+         * 1/sqrt(2) for unit energy). When the total number of symbols is odd,
+         * the last Q component has to be padded by the caller.
+         *
+         * Returns the number of symbols written. Use calculateSymbolCount() to find out
+         * how much memory is needed. The output set by reset() is not used, but the state
+         * of the encoder is shared with encode(), so this method is also suitable for streaming.
+         */
+        template<typename TSymbol>
+        size_t encodeToSymbols(const void *input, size_t inputSize, TSymbol *symbols, TSymbol amplitude = 1) {
+            DEBUG_PRINT("encodeToSymbols()ing");
+            assert(symbols != nullptr);
+            
+            const TSymbol symbolTable[2] = { amplitude, static_cast<TSymbol>(-amplitude) };
+            size_t count = 0;
+            encodeImpl(input, 0, inputSize * 8, [symbols, &symbolTable, &count](uint8_t bit) {
+                symbols[count++] = symbolTable[bit];
+            });
+            
+            return count;
+        }
+        
+        /**
+         * @brief Flushes the encoder into antipodal (BPSK) symbols.
+         *
+         * See encodeToSymbols(). Returns the number of symbols written.
+         */
+        template<typename TSymbol>
+        size_t flushToSymbols(TSymbol *symbols, TSymbol amplitude = 1) {
+            DEBUG_PRINT("flushToSymbols()ing");
+            assert(symbols != nullptr);
+            
+            const TSymbol symbolTable[2] = { amplitude, static_cast<TSymbol>(-amplitude) };
+            size_t count = 0;
+            flushImpl([symbols, &symbolTable, &count](uint8_t bit) {
+                symbols[count++] = symbolTable[bit];
+            });
+            
+            return count;
         }
         
     };
@@ -261,6 +644,14 @@ namespace fecmagic {
     template<typename TPuncturingMatrix, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
     constexpr TShiftReg PuncturedConvolutionalEncoder<TPuncturingMatrix, ConstraintLength, TShiftReg, Polynomials...>::polynomials_[sizeof...(Polynomials)];
     
+    // Definition for the static member PuncturedConvolutionalEncoder::stagingWordCount_
+    template<typename TPuncturingMatrix, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr size_t PuncturedConvolutionalEncoder<TPuncturingMatrix, ConstraintLength, TShiftReg, Polynomials...>::stagingWordCount_;
+    
+    // Definition for the static member PuncturedConvolutionalEncoder::sinkChunkSize_
+    template<typename TPuncturingMatrix, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr size_t PuncturedConvolutionalEncoder<TPuncturingMatrix, ConstraintLength, TShiftReg, Polynomials...>::sinkChunkSize_;
+    
     template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
     using ConvolutionalEncoder = PuncturedConvolutionalEncoder<Sequence<uint8_t, 1>, ConstraintLength, TShiftReg, Polynomials...>;
 
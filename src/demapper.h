@@ -0,0 +1,274 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_DEMAPPER_H
+#define FECMAGIC_DEMAPPER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+
+#include "fecmagic-global.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Modulations supported by SoftDemapper.
+     */
+    enum class Modulation {
+        // One bit per real sample, 0 is +1 and 1 is -1
+        Bpsk,
+        
+        // Two bits per complex sample (Gray mapping as in LTE), the first bit is in I, the second in Q
+        Qpsk,
+        
+        // Four bits per complex sample (Gray mapping as in LTE, 3GPP TS 36.211 7.1.3),
+        // the first two bits are the signs of I and Q, the last two select the inner or outer points
+        Qam16
+    };
+
+    /**
+     * @brief Computes LLRs of the bits from received constellation samples.
+     *
+     * The LLRs are computed with the max-log approximation, scaled and quantized to int8
+     * (saturated to +-127), so they can be given to a soft decoder, like TurboDecoder or
+     * HarqBuffer. As everywhere in fecmagic, positive LLRs mean 0. The constellations are
+     * normalized to unit average energy per complex sample (per real sample for BPSK), and
+     * the noise variance is that of one real dimension, both can be changed at runtime.
+     *
+     * The samples are floats: one real value per symbol for BPSK, and interleaved I/Q pairs
+     * for QPSK and 16-QAM. The computation is vectorized with SSE2 where available.
+     */
+    class SoftDemapper final {
+        
+    private:
+        
+        // The modulation
+        Modulation modulation_;
+        
+        // Noise variance of a real dimension
+        float noiseVariance_;
+        
+        // Number of int8 LLR units per natural LLR unit
+        float scale_;
+        
+        // Distance of the closest constellation points from the axes
+        inline float amplitude() const {
+            switch (modulation_) {
+            case Modulation::Bpsk:
+                return 1.0f;
+            case Modulation::Qpsk:
+                return 1.0f / ::std::sqrt(2.0f);
+            default:
+                return 1.0f / ::std::sqrt(10.0f);
+            }
+        }
+        
+        static inline int8_t quantize(float llr) {
+            llr = (llr > 127.0f) ? 127.0f : ((llr < -127.0f) ? -127.0f : llr);
+            return static_cast<int8_t>(::std::nearbyint(llr));
+        }
+        
+        // The max-log LLR of a bit that is the sign of the sample, for 16-QAM:
+        // linear between the inner points, and steeper beyond them
+        static inline float signLlr16(float y, float a) {
+            float excess = ::std::fabs(y) - 2.0f * a;
+            excess = (excess > 0.0f) ? excess : 0.0f;
+            return y + ((y < 0.0f) ? -excess : excess);
+        }
+        
+        void demapGeneric(const float *samples, size_t sampleCount, int8_t *llr) const {
+            float a = amplitude();
+            
+            // The LLR of the sign bit is 2ay/variance near the axes
+            float factor = 2.0f * a / noiseVariance_ * scale_;
+            
+            if (modulation_ != Modulation::Qam16) {
+                for (size_t i = 0; i < sampleCount; i++) {
+                    llr[i] = quantize(factor * samples[i]);
+                }
+                return;
+            }
+            
+            for (size_t i = 0; i < sampleCount; i += 2) {
+                float y[2] = { samples[i], samples[i + 1] };
+                for (uint32_t d = 0; d < 2; d++) {
+                    llr[2 * i + d] = quantize(factor * signLlr16(y[d], a));
+                    llr[2 * i + 2 + d] = quantize(factor * (2.0f * a - ::std::fabs(y[d])));
+                }
+            }
+        }
+        
+#ifdef COMPILE_SSE2_CODE
+        // Quantizes 16 LLRs at once
+        static inline __m128i quantizeSse2(__m128 l0, __m128 l1, __m128 l2, __m128 l3) {
+            __m128 hi = _mm_set1_ps(127.0f);
+            __m128 lo = _mm_set1_ps(-127.0f);
+            __m128i i0 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(l0, hi), lo));
+            __m128i i1 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(l1, hi), lo));
+            __m128i i2 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(l2, hi), lo));
+            __m128i i3 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(l3, hi), lo));
+            return _mm_packs_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+        }
+        
+        // Computes the sign and magnitude LLRs of 4 samples for 16-QAM
+        static inline void llr16Sse2(__m128 y, __m128 factor, __m128 twoA, __m128 &sign, __m128 &magnitude) {
+            __m128 signMask = _mm_set1_ps(-0.0f);
+            __m128 absY = _mm_andnot_ps(signMask, y);
+            __m128 excess = _mm_max_ps(_mm_sub_ps(absY, twoA), _mm_setzero_ps());
+            excess = _mm_or_ps(excess, _mm_and_ps(y, signMask));
+            sign = _mm_mul_ps(factor, _mm_add_ps(y, excess));
+            magnitude = _mm_mul_ps(factor, _mm_sub_ps(twoA, absY));
+        }
+        
+        void demapSse2(const float *samples, size_t sampleCount, int8_t *llr) const {
+            float a = amplitude();
+            __m128 factor = _mm_set1_ps(2.0f * a / noiseVariance_ * scale_);
+            size_t i = 0;
+            
+            if (modulation_ != Modulation::Qam16) {
+                for (; i + 16 <= sampleCount; i += 16) {
+                    __m128i q = quantizeSse2(
+                        _mm_mul_ps(factor, _mm_loadu_ps(samples + i)),
+                        _mm_mul_ps(factor, _mm_loadu_ps(samples + i + 4)),
+                        _mm_mul_ps(factor, _mm_loadu_ps(samples + i + 8)),
+                        _mm_mul_ps(factor, _mm_loadu_ps(samples + i + 12)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(llr + i), q);
+                }
+            }
+            else {
+                __m128 twoA = _mm_set1_ps(2.0f * a);
+                for (; i + 8 <= sampleCount; i += 8) {
+                    __m128 s0, m0, s1, m1;
+                    llr16Sse2(_mm_loadu_ps(samples + i), factor, twoA, s0, m0);
+                    llr16Sse2(_mm_loadu_ps(samples + i + 4), factor, twoA, s1, m1);
+                    
+                    // Each complex sample gives the sign LLRs of I and Q, then the magnitude LLRs
+                    __m128i q = quantizeSse2(_mm_movelh_ps(s0, m0), _mm_movehl_ps(m0, s0), _mm_movelh_ps(s1, m1), _mm_movehl_ps(m1, s1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(llr + 2 * i), q);
+                }
+            }
+            
+            demapGeneric(samples + i, sampleCount - i, llr + bitsPerSample() * i);
+        }
+#endif
+        
+    public:
+        
+        /**
+         * @brief Creates a demapper.
+         *
+         * The scale is the number of int8 LLR units per natural LLR unit, it should be
+         * chosen so that the LLRs of typical samples don't saturate.
+         */
+        explicit SoftDemapper(Modulation modulation, float noiseVariance = 1.0f, float scale = 8.0f)
+            : modulation_(modulation), noiseVariance_(noiseVariance), scale_(scale) {
+            assert(noiseVariance > 0.0f);
+            assert(scale > 0.0f);
+        }
+        
+        /**
+         * @brief Returns the modulation.
+         */
+        inline Modulation modulation() const {
+            return modulation_;
+        }
+        
+        /**
+         * @brief Returns the number of bits per symbol.
+         */
+        inline uint32_t bitsPerSymbol() const {
+            return (modulation_ == Modulation::Bpsk) ? 1 : ((modulation_ == Modulation::Qpsk) ? 2 : 4);
+        }
+        
+        /**
+         * @brief Returns the number of samples (floats) per symbol.
+         */
+        inline uint32_t samplesPerSymbol() const {
+            return (modulation_ == Modulation::Bpsk) ? 1 : 2;
+        }
+        
+        /**
+         * @brief Returns the number of bits per sample (float).
+         */
+        inline uint32_t bitsPerSample() const {
+            return bitsPerSymbol() / samplesPerSymbol();
+        }
+        
+        /**
+         * @brief Returns the noise variance of a real dimension.
+         */
+        inline float noiseVariance() const {
+            return noiseVariance_;
+        }
+        
+        /**
+         * @brief Sets the noise variance of a real dimension, for example as estimated for the link.
+         */
+        inline void setNoiseVariance(float noiseVariance) {
+            assert(noiseVariance > 0.0f);
+            noiseVariance_ = noiseVariance;
+        }
+        
+        /**
+         * @brief Returns the number of int8 LLR units per natural LLR unit.
+         */
+        inline float scale() const {
+            return scale_;
+        }
+        
+        /**
+         * @brief Sets the number of int8 LLR units per natural LLR unit.
+         */
+        inline void setScale(float scale) {
+            assert(scale > 0.0f);
+            scale_ = scale;
+        }
+        
+        /**
+         * @brief Computes the LLRs of the given symbols.
+         *
+         * The output needs symbolCount * bitsPerSymbol() bytes.
+         * Returns the number of LLRs written.
+         */
+        size_t demap(const float *samples, size_t symbolCount, int8_t *llr) const {
+            assert(samples != nullptr || symbolCount == 0);
+            assert(llr != nullptr || symbolCount == 0);
+            size_t sampleCount = symbolCount * samplesPerSymbol();
+            
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                demapSse2(samples, sampleCount, llr);
+                return symbolCount * bitsPerSymbol();
+            }
+#endif
+            demapGeneric(samples, sampleCount, llr);
+            return symbolCount * bitsPerSymbol();
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_DEMAPPER_H
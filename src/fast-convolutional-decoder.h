@@ -0,0 +1,299 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_FAST_CONVOLUTIONAL_DECODER_H
+#define FECMAGIC_FAST_CONVOLUTIONAL_DECODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "fecmagic-global.h"
+#include "convolutional-decoder.h"
+#include "outputsink.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Statistics of FastPathConvolutionalDecoder.
+     */
+    struct FastPathDecoderStatistics final {
+        // Number of blocks decoded
+        uint64_t blocks = 0;
+        
+        // Number of blocks that had errors, and were decoded by the Viterbi decoder
+        uint64_t fallbackBlocks = 0;
+        
+        // Number of trellis steps taken by the Viterbi decoder
+        uint64_t viterbiSteps = 0;
+    };
+
+    /**
+     * @brief Convolutional decoder that skips the Viterbi algorithm on error-free blocks.
+     *
+     * The input is processed in blocks of 64 steps. Each block is inverted directly from
+     * one of the outputs of the code (a polynomial that contains the bit being shifted in),
+     * then the result is encoded again and compared to all the received bits. An error
+     * can show up in the re-encoded bits up to Depth steps later, so a block is only accepted
+     * when the check also passes for the Depth steps after it. Otherwise, the Viterbi decoder
+     * is run over the block and the last ConstraintLength - 1 steps before it, starting Depth
+     * steps earlier from an unknown state and continuing Depth steps further, so that its
+     * decisions are as reliable as those of a decoder that decodes the whole stream.
+     * This way, the cost of decoding grows with the error rate instead of the data rate.
+     *
+     * For non-catastrophic codes, a wrongly decoded previous block makes the next block
+     * fail the check, so the decoder falls back to Viterbi until it gets back on track.
+     *
+     * The input must be a whole stream that was encoded and flushed by an unpunctured
+     * ConvolutionalEncoder with the same parameters.
+     *
+     * Template parameters:
+     * - Depth: traceback depth of the Viterbi decoder, also used as the number of steps
+     *   before and after an erroneous block that it decodes
+     * - ConstraintLength: the constraint length of the code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - Polynomials: the polynomials used for this convolutional code
+     */
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    class FastPathConvolutionalDecoder final {
+        
+    private:
+        
+        // Number of outputs of the convolutional code (each polynomial corresponds to an output)
+        constexpr static uint32_t outputCount_ = sizeof...(Polynomials);
+        
+        // Unpack variadic template argument, to allow access to each polynomial
+        constexpr static TShiftReg polynomials_[sizeof...(Polynomials)] = { Polynomials... };
+        
+        // Number of steps in a block
+        constexpr static size_t blockSteps_ = 64;
+        
+        // The Viterbi decoder decodes at most 2^maxBlocksLog2_ blocks at once
+        constexpr static uint32_t maxBlocksLog2_ = 4;
+        
+        // The Viterbi decoder used for blocks with errors
+        ConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...> viterbi_;
+        
+        // Output of the Viterbi decoder
+        ::std::vector<uint8_t> viterbiOutput_;
+        
+        // Index of the polynomial that is used for inverting the code
+        uint32_t inversePolynomialIndex_;
+        
+        // Statistics
+        FastPathDecoderStatistics statistics_;
+        
+        // Gets the output of the convolutional encoder for the given state.
+        static inline TShiftReg getEncoderOutput(TShiftReg shiftReg) {
+            TShiftReg output = 0;
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                output <<= 1;
+                output |= ::fecmagic::computeParity(shiftReg & polynomials_[o]);
+            }
+            return output;
+        }
+        
+        // Reads the received bits of a step
+        static inline TShiftReg readSymbol(const uint8_t *input, size_t bitPos) {
+            TShiftReg symbol = 0;
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                symbol = static_cast<TShiftReg>((symbol << 1) | ((input[(bitPos + o) / 8] >> (7 - (bitPos + o) % 8)) & 1));
+            }
+            return symbol;
+        }
+        
+        static inline void putBit(uint8_t *output, size_t pos, uint8_t bit) {
+            uint8_t mask = static_cast<uint8_t>(1 << (7 - pos % 8));
+            output[pos / 8] = static_cast<uint8_t>((output[pos / 8] & ~mask) | (bit ? mask : 0));
+        }
+        
+        // Inverts the steps from verifiedStep until lastStep and checks them by re-encoding,
+        // returns true if they have no errors. The shift register is kept at verifiedStep.
+        inline bool decodeClean(const uint8_t *input, size_t lastStep, uint8_t *output, size_t &verifiedStep, TShiftReg &shiftReg) const {
+            TShiftReg inversePolynomial = polynomials_[inversePolynomialIndex_];
+            uint32_t inverseBitPos = outputCount_ - 1 - inversePolynomialIndex_;
+            
+            for (; verifiedStep < lastStep; verifiedStep++) {
+                TShiftReg received = readSymbol(input, verifiedStep * outputCount_);
+                
+                // The output of the inverse polynomial is the input bit XOR the other taps
+                TShiftReg sr = shiftReg >> 1;
+                uint8_t bit = ((received >> inverseBitPos) & 1) ^ ::fecmagic::computeParity(inversePolynomial & sr);
+                sr |= static_cast<TShiftReg>(bit << (ConstraintLength - 1));
+                
+                // Re-encode and compare
+                if (getEncoderOutput(sr) != received) {
+                    return false;
+                }
+                
+                putBit(output, verifiedStep, bit);
+                shiftReg = sr;
+            }
+            
+            return true;
+        }
+        
+        // Decodes the given steps with the Viterbi decoder, and rewrites the steps before them
+        // that an error in the given steps could affect.
+        void decodeViterbi(const uint8_t *input, size_t firstStep, size_t stepCount, size_t totalSteps, uint8_t *output, TShiftReg &shiftReg) {
+            size_t rewrittenStep = (firstStep > ConstraintLength - 1) ? (firstStep - (ConstraintLength - 1)) : 0;
+            
+            // Start earlier and finish later, so that the metrics can converge
+            size_t start = (rewrittenStep > Depth) ? (rewrittenStep - Depth) : 0;
+            size_t end = ::std::min(totalSteps, firstStep + stepCount + Depth);
+            
+            if (start == 0) {
+                viterbi_.reset(nullptr);
+            }
+            else {
+                viterbi_.resetToUnknownState(nullptr);
+            }
+            
+            BufferSink sink(viterbiOutput_.data(), viterbiOutput_.size());
+            viterbi_.decodeBits(input, start * outputCount_, (end - start) * outputCount_, sink);
+            viterbi_.flushBits(sink);
+            statistics_.viterbiSteps += end - start;
+            
+            // Copy the decoded bits, the shift register is filled by the
+            // at least ConstraintLength steps that are copied after the first one
+            shiftReg = 0;
+            for (size_t t = rewrittenStep; t < firstStep + stepCount; t++) {
+                size_t i = t - start;
+                uint8_t bit = (viterbiOutput_[i / 8] >> (7 - i % 8)) & 1;
+                putBit(output, t, bit);
+                shiftReg = static_cast<TShiftReg>((shiftReg >> 1) | (bit << (ConstraintLength - 1)));
+            }
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates a fast path decoder.
+         */
+        explicit FastPathConvolutionalDecoder()
+            : viterbiOutput_(((blockSteps_ << maxBlocksLog2_) + 2 * Depth + ConstraintLength) / 8 + 2), inversePolynomialIndex_(outputCount_) {
+            // Find a polynomial that contains the bit being shifted in
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                if ((polynomials_[o] >> (ConstraintLength - 1)) & 1) {
+                    inversePolynomialIndex_ = o;
+                    break;
+                }
+            }
+            assert(inversePolynomialIndex_ < outputCount_);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        FastPathConvolutionalDecoder(const FastPathConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        FastPathConvolutionalDecoder &operator=(const FastPathConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            return ConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...>::calculateOutputSize(inputSize);
+        }
+        
+        /**
+         * @brief Returns the statistics gathered so far.
+         */
+        inline const FastPathDecoderStatistics &statistics() const {
+            return statistics_;
+        }
+        
+        /**
+         * @brief Clears the statistics.
+         */
+        inline void resetStatistics() {
+            statistics_ = FastPathDecoderStatistics();
+        }
+        
+        /**
+         * @brief Decodes a whole encoded stream.
+         *
+         * The output must have space for calculateOutputSize(inputSize) bytes.
+         * Bits at the end of the input that don't make up a whole step are ignored.
+         */
+        void decode(const void *input, size_t inputSize, void *output) {
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            uint8_t *outputBytes = reinterpret_cast<uint8_t*>(output);
+            assert(inputBytes != nullptr || inputSize == 0);
+            assert(outputBytes != nullptr);
+            
+            memset(outputBytes, 0, calculateOutputSize(inputSize));
+            
+            size_t totalSteps = inputSize * 8 / outputCount_;
+            TShiftReg shiftReg = 0;
+            size_t step = 0;
+            size_t verifiedStep = 0;
+            uint32_t consecutiveErrors = 0;
+            
+            while (step < totalSteps) {
+                size_t stepCount = ::std::min(blockSteps_, totalSteps - step);
+                
+                // The steps after the block that were already checked aren't checked again
+                if (decodeClean(inputBytes, ::std::min(totalSteps, step + stepCount + Depth), outputBytes, verifiedStep, shiftReg)) {
+                    statistics_.blocks++;
+                    consecutiveErrors = 0;
+                    step += stepCount;
+                    continue;
+                }
+                
+                // When there are errors in consecutive blocks, decode more of them at once,
+                // so that the steps before and after them are decoded fewer times
+                stepCount = ::std::min(blockSteps_ << ::std::min(consecutiveErrors, maxBlocksLog2_), totalSteps - step);
+                consecutiveErrors++;
+                
+                size_t blocks = (stepCount + blockSteps_ - 1) / blockSteps_;
+                statistics_.blocks += blocks;
+                statistics_.fallbackBlocks += blocks;
+                decodeViterbi(inputBytes, step, stepCount, totalSteps, outputBytes, shiftReg);
+                step += stepCount;
+                verifiedStep = step;
+            }
+        }
+        
+    };
+    
+    // Definition for the static member FastPathConvolutionalDecoder::polynomials_
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr TShiftReg FastPathConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...>::polynomials_[sizeof...(Polynomials)];
+    
+    // Definitions for the static members FastPathConvolutionalDecoder::blockSteps_ and FastPathConvolutionalDecoder::maxBlocksLog2_
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr size_t FastPathConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...>::blockSteps_;
+    
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr uint32_t FastPathConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...>::maxBlocksLog2_;
+
+}
+
+#endif // FECMAGIC_FAST_CONVOLUTIONAL_DECODER_H
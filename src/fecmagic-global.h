@@ -41,6 +41,55 @@
 #   define SSE2_SUPPORTED false
 #endif
 
+// Carry-less multiplication, the functions that use it are compiled for it
+// regardless of the compiler flags, and only called when the CPU supports it
+#if defined(COMPILE_PCLMUL_CODE)
+#    include <wmmintrin.h>
+#    if defined(__GNUC__)
+#        define PCLMUL_SUPPORTED __builtin_cpu_supports("pclmul")
+#        define PCLMUL_FUNCTION __attribute__((target("sse2,pclmul")))
+#    else
+#        define PCLMUL_SUPPORTED false
+#        define PCLMUL_FUNCTION
+#    endif
+#endif
+
+#ifndef COMPILE_PCLMUL_CODE
+#   define PCLMUL_SUPPORTED false
+#endif
+
+// Bit manipulation instructions (pext, pdep), the same way as above
+#if defined(COMPILE_BMI2_CODE)
+#    include <immintrin.h>
+#    if defined(__GNUC__)
+#        define BMI2_SUPPORTED __builtin_cpu_supports("bmi2")
+#        define BMI2_FUNCTION __attribute__((target("bmi2")))
+#    else
+#        define BMI2_SUPPORTED false
+#        define BMI2_FUNCTION
+#    endif
+#endif
+
+#ifndef COMPILE_BMI2_CODE
+#   define BMI2_SUPPORTED false
+#endif
+
+// Supplemental SSE3 (pshufb), the same way as above
+#if defined(COMPILE_SSSE3_CODE)
+#    include <tmmintrin.h>
+#    if defined(__GNUC__)
+#        define SSSE3_SUPPORTED __builtin_cpu_supports("ssse3")
+#        define SSSE3_FUNCTION __attribute__((target("ssse3")))
+#    else
+#        define SSSE3_SUPPORTED false
+#        define SSSE3_FUNCTION
+#    endif
+#endif
+
+#ifndef COMPILE_SSSE3_CODE
+#   define SSSE3_SUPPORTED false
+#endif
+
 namespace fecmagic {
 
     /**
@@ -24,14 +24,207 @@
 #ifndef GOLAY_H
 #define GOLAY_H
 
+#include <cstring>
+
 #include "blockcode.h"
 
 namespace fecmagic {
 
-    class GolayCode final : public BlockCode<3, uint32_t, uint16_t, uint16_t> {
+    /**
+     * @brief Extended Golay(24, 12) code.
+     *
+     * Codewords are 24 bits: the 12 data bits followed by 12 parity bits (the data
+     * multiplied by the B matrix of the code). It corrects up to 3 errors, and
+     * detects 4 errors.
+     */
+    class GolayCode final : public BlockCode<GolayCode, 3, uint32_t, uint16_t, uint16_t> {
+    private:
+        
+        // Tables of the code, computed from the generator matrix
+        struct Tables final {
+            // Rows and columns of the B matrix
+            uint16_t rows[12];
+            uint16_t cols[12];
+            
+            // Products of the low and high 6 bits of a vector with B
+            uint16_t multiplyLow[64];
+            uint16_t multiplyHigh[64];
+            
+            // Error pattern of each syndrome (data part in the high 12 bits), 0 when there are at least 4 errors
+            uint32_t errorPatterns[4096];
+            
+            // Bits of the rows and columns of B, as all-zero or all-one masks for bit slicing
+            uint64_t rowMasks[12][12];
+            uint64_t colMasks[12][12];
+            
+            // Multiplies a vector with B, or with its transpose
+            static inline uint16_t multiply(const uint16_t *matrix, uint16_t x) {
+                uint16_t result = 0;
+                for (unsigned i = 0; i < 12; i++) {
+                    result ^= static_cast<uint16_t>(matrix[i] & -((x >> i) & 1));
+                }
+                return result;
+            }
+            
+            // Finds the error pattern of a syndrome with the arithmetic decoding algorithm
+            // of the extended Golay code. With the codeword split into the data part x and
+            // the parity part y, the syndrome is s = xB + y. Since B is orthogonal,
+            // q = sB^T = x + yB^T is the other syndrome. When there are at most 3 errors,
+            // one of these holds:
+            // - all errors are in the parity part: weight of s is at most 3
+            // - one error is in data bit i: weight of s + (row i of B) is at most 2
+            // - all errors are in the data part: weight of q is at most 3
+            // - one error is in parity bit i: weight of q + (column i of B) is at most 2
+            // Otherwise there are at least 4 errors.
+            inline uint32_t findErrorPattern(uint16_t s) const {
+                if (computePopcount(s) <= 3) {
+                    return s;
+                }
+                
+                uint16_t q = multiply(cols, s);
+                if (computePopcount(q) <= 3) {
+                    return static_cast<uint32_t>(q) << 12;
+                }
+                
+                for (unsigned i = 0; i < 12; i++) {
+                    if (computePopcount(s ^ rows[i]) <= 2) {
+                        return (static_cast<uint32_t>(1) << (12 + i)) | (s ^ rows[i]);
+                    }
+                    if (computePopcount(q ^ cols[i]) <= 2) {
+                        return (static_cast<uint32_t>(q ^ cols[i]) << 12) | (1u << i);
+                    }
+                }
+                
+                return 0;
+            }
+            
+            explicit Tables(const GolayCode &code) {
+                for (unsigned i = 0; i < 12; i++) {
+                    rows[i] = static_cast<uint16_t>(code.encode(static_cast<uint16_t>(1 << i)) & 0xfff);
+                }
+                for (unsigned i = 0; i < 12; i++) {
+                    cols[i] = 0;
+                    for (unsigned j = 0; j < 12; j++) {
+                        cols[i] |= static_cast<uint16_t>(((rows[j] >> i) & 1) << j);
+                    }
+                }
+                for (unsigned x = 0; x < 64; x++) {
+                    multiplyLow[x] = multiply(rows, static_cast<uint16_t>(x));
+                    multiplyHigh[x] = multiply(rows, static_cast<uint16_t>(x << 6));
+                }
+                for (unsigned s = 0; s < 4096; s++) {
+                    errorPatterns[s] = findErrorPattern(static_cast<uint16_t>(s));
+                }
+                for (unsigned i = 0; i < 12; i++) {
+                    for (unsigned j = 0; j < 12; j++) {
+                        rowMasks[i][j] = 0 - static_cast<uint64_t>((rows[i] >> j) & 1);
+                        colMasks[i][j] = 0 - static_cast<uint64_t>((cols[i] >> j) & 1);
+                    }
+                }
+            }
+        };
+        
+        inline const Tables &tables() const {
+            static const Tables t(*this);
+            return t;
+        }
+        
+        // Tells which lanes of a bit-sliced 12-bit vector (XORed with a constant, given as masks)
+        // have a weight of at most 2 and at most 3, by adding up the bits with saturation
+        static inline void calculateBitSlicedWeight(const uint64_t *planes, const uint64_t *flip, uint64_t &atMost2, uint64_t &atMost3) {
+            uint64_t ones = 0, twos = 0, fours = 0;
+            for (unsigned j = 0; j < 12; j++) {
+                uint64_t x = planes[j] ^ flip[j];
+                uint64_t carry = ones & x;
+                ones ^= x;
+                fours |= twos & carry;
+                twos ^= carry;
+            }
+            atMost3 = ~fours;
+            atMost2 = ~fours & ~(ones & twos);
+        }
+        
+        // Transposes 64 codewords into 24 bit planes, bit i of a plane belongs to codeword i
+        static inline void transposeToPlanes(const uint32_t *codewords, uint64_t *planes) {
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                for (unsigned b = 0; b < 24; b++) {
+                    planes[b] = 0;
+                }
+                for (unsigned c = 0; c < 64; c += 16) {
+                    __m128i v[4];
+                    for (unsigned k = 0; k < 4; k++) {
+                        v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codewords + c + 4 * k));
+                    }
+                    for (unsigned byte = 0; byte < 3; byte++) {
+                        // Gather this byte of the 16 codewords, then take their bits with movemask
+                        const __m128i mask = _mm_set1_epi32(0xff);
+                        __m128i x = _mm_packus_epi16(
+                            _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[0], 8 * byte), mask), _mm_and_si128(_mm_srli_epi32(v[1], 8 * byte), mask)),
+                            _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[2], 8 * byte), mask), _mm_and_si128(_mm_srli_epi32(v[3], 8 * byte), mask)));
+                        for (int bit = 7; bit >= 0; bit--) {
+                            planes[8 * byte + bit] |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(x))) << c;
+                            x = _mm_add_epi8(x, x);
+                        }
+                    }
+                }
+                return;
+            }
+#endif
+            
+            for (unsigned b = 0; b < 24; b++) {
+                uint64_t plane = 0;
+                for (unsigned i = 0; i < 64; i++) {
+                    plane |= static_cast<uint64_t>((codewords[i] >> b) & 1) << i;
+                }
+                planes[b] = plane;
+            }
+        }
+        
+        // Transposes 12 bit planes back into 64 data words
+        static inline void transposeFromPlanes(const uint64_t *planes, uint16_t *data) {
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+                for (unsigned c = 0; c < 64; c += 16) {
+                    // Low and high bytes of the 16 data words
+                    __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+                    for (unsigned k = 0; k < 12; k++) {
+                        // Every lane selects its own bit of the plane
+                        uint16_t chunk = static_cast<uint16_t>(planes[k] >> c);
+                        __m128i x = _mm_unpacklo_epi64(_mm_set1_epi8(static_cast<char>(chunk & 0xff)), _mm_set1_epi8(static_cast<char>(chunk >> 8)));
+                        x = _mm_cmpeq_epi8(_mm_and_si128(x, bits), bits);
+                        if (k < 8) {
+                            low = _mm_or_si128(low, _mm_and_si128(x, _mm_set1_epi8(static_cast<char>(1 << k))));
+                        }
+                        else {
+                            high = _mm_or_si128(high, _mm_and_si128(x, _mm_set1_epi8(static_cast<char>(1 << (k - 8)))));
+                        }
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + c), _mm_unpacklo_epi8(low, high));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + c + 8), _mm_unpackhi_epi8(low, high));
+                }
+                return;
+            }
+#endif
+            
+            for (unsigned i = 0; i < 64; i++) {
+                uint16_t word = 0;
+                for (unsigned k = 0; k < 12; k++) {
+                    word |= static_cast<uint16_t>(((planes[k] >> i) & 1) << k);
+                }
+                data[i] = word;
+            }
+        }
+        
     public:
-        inline explicit GolayCode()
-            : BlockCode({
+        inline explicit GolayCode() { }
+        
+        /**
+         * Gets the generator matrix of the code.
+         */
+        static inline const GeneratorMatrix &generatorMatrix() {
+            static constexpr GeneratorMatrix m = {
                 // 24x12 generator matrix (represented in 32x16)
                 0, 0,
                 0, 0,
@@ -65,7 +258,15 @@ namespace fecmagic {
                 0b00000011, 0b11100110,
                 0b00000101, 0b01010111,
                 0b00001010, 0b10101011,
-            }, {
+            };
+            return m;
+        }
+        
+        /**
+         * Gets the parity check matrix of the code.
+         */
+        static inline const ParityCheckMatrix &parityCheckMatrix() {
+            static constexpr ParityCheckMatrix m = {
                 // 12x24 parity check matrix (represented as 16x32)
                 0, 0, 0,
                 0, 0, 0,
@@ -83,7 +284,15 @@ namespace fecmagic {
                 0, 0b00111110, 0b01100000, 0b00000100,
                 0, 0b01010101, 0b01110000, 0b00000010,
                 0, 0b10101010, 0b10110000, 0b00000001,
-            }, {
+            };
+            return m;
+        }
+        
+        /**
+         * Gets the decoder matrix of the code.
+         */
+        static inline const DecoderMatrix &decoderMatrix() {
+            static constexpr DecoderMatrix m = {
                 // 12x24 decode matrix (represented as 16x32)
                 0, 0, 0, 0,
                 0, 0, 0, 0,
@@ -101,7 +310,129 @@ namespace fecmagic {
                 0, 0b00000000, 0b01000000, 0,
                 0, 0b00000000, 0b00100000, 0,
                 0, 0b00000000, 0b00010000, 0,
-            }) { }
+            };
+            return m;
+        }
+        
+        /**
+         * @brief Decodes a codeword, and tells the number of corrected bits.
+         *
+         * The syndrome is computed with the structure of the code, and the error pattern
+         * is looked up in a table of 4096 entries, which is built once with the arithmetic
+         * decoding algorithm. So decoding takes the same time regardless of the errors.
+         * When there are 4 errors, success is set to false.
+         */
+        inline uint16_t decode(const uint32_t &input, bool &success, unsigned &correctedBits) const {
+            const Tables &t = tables();
+            uint16_t data = static_cast<uint16_t>((input >> 12) & 0xfff);
+            uint16_t s = t.multiplyLow[data & 0x3f] ^ t.multiplyHigh[data >> 6] ^ static_cast<uint16_t>(input & 0xfff);
+            uint32_t errorPattern = t.errorPatterns[s];
+            
+            success = (s == 0) || (errorPattern != 0);
+            correctedBits = computePopcount(errorPattern);
+            return success ? static_cast<uint16_t>(data ^ (errorPattern >> 12)) : 0;
+        }
+        
+        /**
+         * @brief Decodes many codewords at once, with bit slicing.
+         *
+         * The codewords are transposed into bit planes in groups of 64, then the syndromes
+         * and the decisions of the arithmetic decoding algorithm are computed with bitwise
+         * operations over all of them at once, without branches or table lookups.
+         * So the throughput doesn't depend on how many codewords have errors.
+         *
+         * When a status bitmap of (count + 7) / 8 bytes is given, the bit of each
+         * codeword (MSB first) is set when it had an unfixable error. Such codewords
+         * are decoded to 0, the same way as by decode.
+         *
+         * Returns the number of codewords with unfixable errors.
+         */
+        inline size_t decodeBatch(const uint32_t *input, size_t count, uint16_t *output, uint8_t *status = nullptr) const {
+            const Tables &t = tables();
+            static const uint64_t noFlip[12] = { 0 };
+            size_t failedCodewords = 0;
+            
+            for (size_t start = 0; start < count; start += 64) {
+                size_t n = (count - start) < 64 ? (count - start) : 64;
+                
+                // The unused lanes hold valid (zero) codewords
+                uint32_t codewords[64] = { 0 };
+                std::memcpy(codewords, input + start, n * sizeof(uint32_t));
+                uint64_t planes[24];
+                transposeToPlanes(codewords, planes);
+                
+                // Planes of the data and parity bits, and of the syndromes s = xB + y and q = sB^T
+                const uint64_t *data = planes + 12;
+                uint64_t s[12], q[12];
+                for (unsigned j = 0; j < 12; j++) {
+                    s[j] = planes[j];
+                    for (unsigned i = 0; i < 12; i++) {
+                        s[j] ^= data[i] & t.rowMasks[i][j];
+                    }
+                }
+                for (unsigned j = 0; j < 12; j++) {
+                    q[j] = 0;
+                    for (unsigned k = 0; k < 12; k++) {
+                        q[j] ^= s[k] & t.colMasks[k][j];
+                    }
+                }
+                
+                // The same cases as in Tables::findErrorPattern, the first one that holds
+                // gives the error pattern of the data part in each lane
+                uint64_t atMost2, atMost3, selected;
+                uint64_t dataErrors[12] = { 0 };
+                
+                calculateBitSlicedWeight(s, noFlip, atMost2, atMost3);
+                uint64_t found = atMost3;
+                
+                calculateBitSlicedWeight(q, noFlip, atMost2, atMost3);
+                selected = atMost3 & ~found;
+                for (unsigned k = 0; k < 12; k++) {
+                    dataErrors[k] |= selected & q[k];
+                }
+                found |= atMost3;
+                
+                for (unsigned i = 0; i < 12; i++) {
+                    calculateBitSlicedWeight(s, t.rowMasks[i], atMost2, atMost3);
+                    dataErrors[i] |= atMost2 & ~found;
+                    found |= atMost2;
+                    
+                    calculateBitSlicedWeight(q, t.colMasks[i], atMost2, atMost3);
+                    selected = atMost2 & ~found;
+                    for (unsigned k = 0; k < 12; k++) {
+                        dataErrors[k] |= selected & (q[k] ^ t.colMasks[i][k]);
+                    }
+                    found |= atMost2;
+                }
+                
+                // Corrected data planes, failed lanes are 0
+                uint64_t decodedPlanes[12];
+                for (unsigned k = 0; k < 12; k++) {
+                    decodedPlanes[k] = (data[k] ^ dataErrors[k]) & found;
+                }
+                uint16_t decoded[64];
+                transposeFromPlanes(decodedPlanes, decoded);
+                std::memcpy(output + start, decoded, n * sizeof(uint16_t));
+                
+                uint64_t failed = ~found;
+                failedCodewords += computePopcount(static_cast<uint32_t>(failed)) + computePopcount(static_cast<uint32_t>(failed >> 32));
+                if (status != nullptr) {
+                    for (size_t k = 0; k < (n + 7) / 8; k++) {
+                        status[start / 8 + k] = bitreverse_8(static_cast<uint8_t>(failed >> (8 * k)));
+                    }
+                }
+            }
+            
+            return failedCodewords;
+        }
+        
+        /**
+         * @brief Decodes a codeword, or tells if an unfixable error is detected.
+         */
+        inline uint16_t decode(const uint32_t &input, bool &success) const {
+            unsigned correctedBits;
+            return decode(input, success, correctedBits);
+        }
     };
 
 }
@@ -24,15 +24,130 @@
 #ifndef HAMMING_H
 #define HAMMING_H
 
+#include <cstddef>
 #include "blockcode.h"
 
 namespace fecmagic {
 
-    class HammingCode final : public BlockCode<1, uint8_t, uint8_t, uint8_t> {
+    /**
+     * Summary of decoding a buffer of Hamming codewords.
+     *
+     * Every syndrome of the Hamming code belongs to a single bit error, so
+     * codewords with more errors are miscorrected instead of being detected.
+     */
+    struct HammingDecodingSummary {
+        // Number of decoded codewords
+        size_t codewords;
+        // Number of codewords in which a bit error was corrected
+        size_t correctedCodewords;
+    };
+
+    class HammingCode final : public BlockCode<HammingCode, 1, uint8_t, uint8_t, uint8_t> {
+    private:
+        
+        // 16-entry tables, so that both nibbles of a codeword can be looked up
+        // with a pshufb. Everything is linear, so the syndrome and the source block
+        // of a codeword are the XOR of those of its low and high nibble, and fixing
+        // an error flips the source bits that the error pattern of the syndrome would.
+        struct NibbleTables {
+            alignas(16) uint8_t encoded[16];
+            alignas(16) uint8_t syndromeLow[16];
+            alignas(16) uint8_t syndromeHigh[16];
+            alignas(16) uint8_t sourceLow[16];
+            alignas(16) uint8_t sourceHigh[16];
+            alignas(16) uint8_t sourceFix[16];
+            
+            explicit NibbleTables(const HammingCode &code) {
+                for (unsigned x = 0; x < 16; x++) {
+                    encoded[x] = code.encode(static_cast<uint8_t>(x));
+                    syndromeLow[x] = code.calculateSyndrome(static_cast<uint8_t>(x));
+                    syndromeHigh[x] = code.calculateSyndrome(static_cast<uint8_t>(x << 4));
+                    sourceLow[x] = code.calculateSourceBlock(static_cast<uint8_t>(x));
+                    sourceHigh[x] = code.calculateSourceBlock(static_cast<uint8_t>(x << 4));
+                    sourceFix[x] = 0;
+                }
+                for (unsigned i = 0; i < 7; i++) {
+                    uint8_t errorPattern = static_cast<uint8_t>(1 << i);
+                    sourceFix[code.calculateSyndrome(errorPattern)] = code.calculateSourceBlock(errorPattern);
+                }
+            }
+            
+            inline uint8_t decode(uint8_t codeword, size_t &correctedCodewords) const {
+                uint8_t syndrome = syndromeLow[codeword & 0x0f] ^ syndromeHigh[codeword >> 4];
+                correctedCodewords += (syndrome != 0);
+                return sourceLow[codeword & 0x0f] ^ sourceHigh[codeword >> 4] ^ sourceFix[syndrome];
+            }
+        };
+        
+        inline const NibbleTables &nibbleTables() const {
+            static const NibbleTables t(*this);
+            return t;
+        }
+        
+#ifdef COMPILE_SSSE3_CODE
+        SSSE3_FUNCTION
+        inline size_t encodeNibblesSsse3(const NibbleTables &t, const uint8_t *input, size_t inputSize, uint8_t *output) const {
+            const __m128i table = _mm_load_si128(reinterpret_cast<const __m128i*>(t.encoded));
+            const __m128i mask = _mm_set1_epi8(0x0f);
+            size_t i = 0;
+            
+            for (; i + 16 <= inputSize; i += 16) {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+                __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(x, mask));
+                
+                // Interleave, so that the high nibble comes first
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * i), _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+            }
+            
+            return i;
+        }
+        
+        SSSE3_FUNCTION
+        inline __m128i decodeNibblesSsse3(const NibbleTables &t, __m128i codewords, size_t &correctedCodewords) const {
+            const __m128i mask = _mm_set1_epi8(0x0f);
+            __m128i low = _mm_and_si128(codewords, mask);
+            __m128i high = _mm_and_si128(_mm_srli_epi16(codewords, 4), mask);
+            
+            __m128i syndrome = _mm_xor_si128(
+                _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.syndromeLow)), low),
+                _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.syndromeHigh)), high));
+            __m128i source = _mm_xor_si128(
+                _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.sourceLow)), low),
+                _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.sourceHigh)), high));
+            source = _mm_xor_si128(source, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.sourceFix)), syndrome));
+            
+            unsigned clean = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(syndrome, _mm_setzero_si128())));
+            correctedCodewords += 16 - computePopcount(clean);
+            
+            // Multiply the first nibble of each pair by 16 and add the second one
+            return _mm_maddubs_epi16(source, _mm_set1_epi16(0x0110));
+        }
+        
+        SSSE3_FUNCTION
+        inline size_t decodeNibblesSsse3(const NibbleTables &t, const uint8_t *input, size_t codewordCount, uint8_t *output, size_t &correctedCodewords) const {
+            size_t i = 0;
+            
+            for (; i + 32 <= codewordCount; i += 32) {
+                __m128i first = decodeNibblesSsse3(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)), correctedCodewords);
+                __m128i second = decodeNibblesSsse3(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 16)), correctedCodewords);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i / 2), _mm_packus_epi16(first, second));
+            }
+            
+            return i;
+        }
+#endif
+        
     public:
         // TODO: add the possibility of choosing different Hamming codes
-        inline explicit HammingCode()
-            : BlockCode({
+        inline explicit HammingCode() { }
+        
+        /**
+         * Gets the generator matrix of the code.
+         */
+        static inline const GeneratorMatrix &generatorMatrix() {
+            static constexpr GeneratorMatrix m = {
                 0,
                 0b00001101,
                 0b00001011,
@@ -41,7 +156,15 @@ namespace fecmagic {
                 0b00000100,
                 0b00000010,
                 0b00000001,
-            }, {
+            };
+            return m;
+        }
+        
+        /**
+         * Gets the parity check matrix of the code.
+         */
+        static inline const ParityCheckMatrix &parityCheckMatrix() {
+            static constexpr ParityCheckMatrix m = {
                 0,
                 0,
                 0,
@@ -50,7 +173,15 @@ namespace fecmagic {
                 0b01010101,
                 0b00110011,
                 0b00001111,
-            }, {
+            };
+            return m;
+        }
+        
+        /**
+         * Gets the decoder matrix of the code.
+         */
+        static inline const DecoderMatrix &decoderMatrix() {
+            static constexpr DecoderMatrix m = {
                 0,
                 0,
                 0,
@@ -59,7 +190,71 @@ namespace fecmagic {
                 0b00000100,
                 0b00000010,
                 0b00000001,
-            }) { }
+            };
+            return m;
+        }
+        
+        /**
+         * Calculates the number of codewords (and output bytes) for
+         * an input of the given size.
+         */
+        static inline size_t calculateCodewordCount(size_t inputSize) {
+            return inputSize * 2;
+        }
+        
+        /**
+         * Encodes every nibble of the input into a codeword byte,
+         * the high nibble of each byte first.
+         * The output must be calculateCodewordCount(inputSize) bytes long.
+         *
+         * Uses pshufb to encode 16 bytes at a time when SSSE3 is available.
+         */
+        inline void encodeNibbles(const uint8_t *input, size_t inputSize, uint8_t *output) const {
+            const NibbleTables &t = nibbleTables();
+            size_t i = 0;
+            
+#ifdef COMPILE_SSSE3_CODE
+            if (SSSE3_SUPPORTED) {
+                i = encodeNibblesSsse3(t, input, inputSize, output);
+            }
+#endif
+            
+            for (; i < inputSize; i++) {
+                output[2 * i] = t.encoded[input[i] >> 4];
+                output[2 * i + 1] = t.encoded[input[i] & 0x0f];
+            }
+        }
+        
+        /**
+         * Decodes codeword bytes into nibbles, correcting single bit errors.
+         * Two codewords make up an output byte, the first one in the high nibble,
+         * so the output must be (codewordCount + 1) / 2 bytes long.
+         * When there is an odd number of codewords, the low nibble of the last byte is 0.
+         *
+         * Uses pshufb to decode 32 codewords at a time when SSSE3 is available.
+         */
+        inline HammingDecodingSummary decodeNibbles(const uint8_t *input, size_t codewordCount, uint8_t *output) const {
+            const NibbleTables &t = nibbleTables();
+            HammingDecodingSummary summary = { codewordCount, 0 };
+            size_t i = 0;
+            
+#ifdef COMPILE_SSSE3_CODE
+            if (SSSE3_SUPPORTED) {
+                i = decodeNibblesSsse3(t, input, codewordCount, output, summary.correctedCodewords);
+            }
+#endif
+            
+            for (; i + 2 <= codewordCount; i += 2) {
+                uint8_t high = t.decode(input[i], summary.correctedCodewords);
+                uint8_t low = t.decode(input[i + 1], summary.correctedCodewords);
+                output[i / 2] = static_cast<uint8_t>((high << 4) | low);
+            }
+            if (i < codewordCount) {
+                output[i / 2] = static_cast<uint8_t>(t.decode(input[i], summary.correctedCodewords) << 4);
+            }
+            
+            return summary;
+        }
     };
 
 }
@@ -0,0 +1,228 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_HARQ_H
+#define FECMAGIC_HARQ_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "fecmagic-global.h"
+#include "puncturing.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Soft combining buffer for hybrid ARQ (HARQ) retransmissions.
+     *
+     * Accumulates the soft values (LLRs, positive for 0) of every transmission of a frame
+     * of the mother code, so that the decoder gets the combined information of all of them
+     * instead of starting from scratch with the new copy. It supports:
+     * - chase combining: every transmission is the same, the LLRs are added
+     * - incremental redundancy: the transmissions are punctured with different patterns
+     *   (for example of a RateCompatiblePuncturingFamily), each of them is depunctured and
+     *   added, so the bits that weren't sent yet stay at 0 (no information)
+     *
+     * The additions saturate, and are vectorized with SSE2 where available.
+     * The combined LLRs can be given to a soft decoder (like TurboDecoder), or exported
+     * as hard decisions with an erasure bitmap for the Viterbi decoder.
+     */
+    class HarqBuffer final {
+        
+    private:
+        
+        // Combined LLRs
+        ::std::vector<int8_t> llr_;
+        
+        // Depunctured LLRs of the current transmission
+        ::std::vector<int8_t> depunctured_;
+        
+        // Number of transmissions combined since the last reset
+        uint32_t transmissionCount_;
+        
+        static inline int8_t saturatingAdd(int8_t a, int8_t b) {
+            int32_t sum = static_cast<int32_t>(a) + static_cast<int32_t>(b);
+            return static_cast<int8_t>((sum > 127) ? 127 : ((sum < -128) ? -128 : sum));
+        }
+        
+        static void accumulateGeneric(int8_t *acc, const int8_t *input, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                acc[i] = saturatingAdd(acc[i], input[i]);
+            }
+        }
+        
+        static void hardDecisionGeneric(const int8_t *llr, size_t count, uint8_t *bits, uint8_t *erasures) {
+            for (size_t i = 0; i < count; i++) {
+                if (i % 8 == 0) {
+                    bits[i / 8] = 0;
+                    erasures[i / 8] = 0;
+                }
+                uint8_t shift = static_cast<uint8_t>(7 - i % 8);
+                bits[i / 8] |= static_cast<uint8_t>((llr[i] < 0 ? 1 : 0) << shift);
+                erasures[i / 8] |= static_cast<uint8_t>((llr[i] == 0 ? 1 : 0) << shift);
+            }
+        }
+        
+#ifdef COMPILE_SSE2_CODE
+        // Saturating addition of 16 LLRs at a time
+        static void accumulateSse2(int8_t *acc, const int8_t *input, size_t count) {
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_adds_epi8(a, b));
+            }
+            accumulateGeneric(acc + i, input + i, count - i);
+        }
+        
+        // Hard decisions of 16 LLRs at a time: the sign bits and the zero lanes are gathered with movemask
+        static void hardDecisionSse2(const int8_t *llr, size_t count, uint8_t *bits, uint8_t *erasures) {
+            size_t i = 0;
+            __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= count; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(llr + i));
+                uint32_t signs = static_cast<uint32_t>(_mm_movemask_epi8(v));
+                uint32_t zeroes = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+                
+                // The first LLR is the LSB of the mask, but the MSB of the output
+                bits[i / 8] = ::fecmagic::bitreverse_8(static_cast<uint8_t>(signs));
+                bits[i / 8 + 1] = ::fecmagic::bitreverse_8(static_cast<uint8_t>(signs >> 8));
+                erasures[i / 8] = ::fecmagic::bitreverse_8(static_cast<uint8_t>(zeroes));
+                erasures[i / 8 + 1] = ::fecmagic::bitreverse_8(static_cast<uint8_t>(zeroes >> 8));
+            }
+            hardDecisionGeneric(llr + i, count - i, bits + i / 8, erasures + i / 8);
+        }
+#endif
+        
+        inline void accumulate(const int8_t *input) {
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                accumulateSse2(llr_.data(), input, llr_.size());
+                return;
+            }
+#endif
+            accumulateGeneric(llr_.data(), input, llr_.size());
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates a buffer for frames of the given number of (unpunctured) soft values.
+         */
+        explicit HarqBuffer(size_t size)
+            : llr_(size, 0), depunctured_(size, 0), transmissionCount_(0) { }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        HarqBuffer(const HarqBuffer &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        HarqBuffer &operator=(const HarqBuffer &other) = delete;
+        
+        /**
+         * @brief Returns the number of soft values of a frame.
+         */
+        inline size_t size() const {
+            return llr_.size();
+        }
+        
+        /**
+         * @brief Returns the number of transmissions combined since the last reset.
+         */
+        inline uint32_t transmissionCount() const {
+            return transmissionCount_;
+        }
+        
+        /**
+         * @brief Returns the combined LLRs.
+         */
+        inline const int8_t *llr() const {
+            return llr_.data();
+        }
+        
+        /**
+         * @brief Clears the buffer for a new frame.
+         */
+        void reset() {
+            memset(llr_.data(), 0, llr_.size());
+            transmissionCount_ = 0;
+        }
+        
+        /**
+         * @brief Adds a transmission of the whole frame (chase combining).
+         *
+         * The input has size() soft values.
+         */
+        void combine(const int8_t *input) {
+            assert(input != nullptr || llr_.empty());
+            accumulate(input);
+            transmissionCount_++;
+        }
+        
+        /**
+         * @brief Adds a punctured transmission of the frame (incremental redundancy).
+         *
+         * The input has the soft values that remain after puncturing size() values with
+         * the given stage, starting at the given phase. Returns the number of input values.
+         */
+        size_t combine(const int8_t *input, const PuncturingStage &stage, size_t phase = 0) {
+            assert(input != nullptr || llr_.empty());
+            size_t consumed = stage.depunctureSoft(input, depunctured_.data(), depunctured_.size(), phase);
+            accumulate(depunctured_.data());
+            transmissionCount_++;
+            return consumed;
+        }
+        
+        /**
+         * @brief Exports the combined LLRs as hard decisions, for a hard-decision decoder.
+         *
+         * Writes one bit for each soft value (MSB first) to the output, and an erasure bitmap
+         * with the same layout, which marks the values that have no information (0), for
+         * example because they weren't transmitted yet. Both need (size() + 7) / 8 bytes.
+         */
+        void hardDecision(void *output, void *erasures) const {
+            uint8_t *outputBytes = reinterpret_cast<uint8_t*>(output);
+            uint8_t *erasureBytes = reinterpret_cast<uint8_t*>(erasures);
+            assert(outputBytes != nullptr);
+            assert(erasureBytes != nullptr);
+            
+#ifdef COMPILE_SSE2_CODE
+            if (SSE2_SUPPORTED) {
+                hardDecisionSse2(llr_.data(), llr_.size(), outputBytes, erasureBytes);
+                return;
+            }
+#endif
+            hardDecisionGeneric(llr_.data(), llr_.size(), outputBytes, erasureBytes);
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_HARQ_H
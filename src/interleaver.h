@@ -0,0 +1,313 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_INTERLEAVER_H
+#define FECMAGIC_INTERLEAVER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+namespace fecmagic {
+
+    /**
+     * @brief Interleaver that permutes a block of a fixed size.
+     *
+     * The permutation is stored as a table, so that interleaving costs
+     * one lookup per item regardless of how the permutation was created.
+     * The convention is that the i-th output item is the permutation(i)-th
+     * input item, as in the LTE turbo code.
+     *
+     * This class can be used with any permutation table. Derived classes
+     * create commonly used permutations, such as QPP and S-random.
+     */
+    class Interleaver {
+    protected:
+        
+        // The permutation table
+        std::vector<uint32_t> permutation_;
+        
+        inline explicit Interleaver() { }
+        
+    public:
+        
+        /**
+         * @brief Creates an interleaver from the given permutation table.
+         */
+        inline explicit Interleaver(std::vector<uint32_t> permutation)
+            : permutation_(std::move(permutation)) {
+            assert(isValid());
+        }
+        
+        /**
+         * @brief Returns the number of items in a block.
+         */
+        inline size_t size() const {
+            return permutation_.size();
+        }
+        
+        /**
+         * @brief Returns the input position of the given output position.
+         */
+        inline uint32_t operator[](size_t i) const {
+            return permutation_[i];
+        }
+        
+        /**
+         * @brief Returns the permutation table.
+         */
+        inline const uint32_t *permutation() const {
+            return permutation_.data();
+        }
+        
+        /**
+         * @brief Checks whether the table is really a permutation.
+         */
+        bool isValid() const {
+            std::vector<bool> seen(permutation_.size(), false);
+            for (uint32_t p : permutation_) {
+                if (p >= permutation_.size() || seen[p]) {
+                    return false;
+                }
+                seen[p] = true;
+            }
+            return true;
+        }
+        
+        /**
+         * @brief Interleaves a block of items.
+         */
+        template<typename T>
+        inline void interleave(const T *input, T *output) const {
+            assert(input != output);
+            const size_t n = permutation_.size();
+            for (size_t i = 0; i < n; i++) {
+                output[i] = input[permutation_[i]];
+            }
+        }
+        
+        /**
+         * @brief Deinterleaves a block of items, this is the inverse of interleave().
+         */
+        template<typename T>
+        inline void deinterleave(const T *input, T *output) const {
+            assert(input != output);
+            const size_t n = permutation_.size();
+            for (size_t i = 0; i < n; i++) {
+                output[permutation_[i]] = input[i];
+            }
+        }
+        
+        /**
+         * @brief Interleaves a block of bits, packed into bytes (MSB first).
+         *
+         * The block size must be a multiple of 8. The bits are first unpacked
+         * into the scratch buffer (one byte for each bit, so it must have size()
+         * bytes), which makes gathering them a lot faster than extracting
+         * each bit from the packed input.
+         */
+        void interleaveBits(const uint8_t *input, uint8_t *output, uint8_t *scratch) const {
+            assert(input != output);
+            assert(permutation_.size() % 8 == 0);
+            
+            // Table that unpacks a byte into eight bytes of zeroes and ones
+            struct UnpackTable final {
+                uint8_t bits[256][8];
+                
+                explicit UnpackTable() {
+                    for (uint32_t b = 0; b < 256; b++) {
+                        for (uint32_t i = 0; i < 8; i++) {
+                            bits[b][i] = (b >> (7 - i)) & 1;
+                        }
+                    }
+                }
+            };
+            static const UnpackTable unpack;
+            
+            const size_t byteCount = permutation_.size() / 8;
+            for (size_t i = 0; i < byteCount; i++) {
+                memcpy(scratch + 8 * i, unpack.bits[input[i]], 8);
+            }
+            
+            const uint32_t *p = permutation_.data();
+            for (size_t i = 0; i < byteCount; i++, p += 8) {
+                output[i] = static_cast<uint8_t>(
+                    (scratch[p[0]] << 7) | (scratch[p[1]] << 6) | (scratch[p[2]] << 5) | (scratch[p[3]] << 4) |
+                    (scratch[p[4]] << 3) | (scratch[p[5]] << 2) | (scratch[p[6]] << 1) | scratch[p[7]]);
+            }
+        }
+        
+        /**
+         * @brief Interleaves a block of bits, packed into bytes (MSB first).
+         *
+         * The block size must be a multiple of 8.
+         */
+        void interleaveBits(const uint8_t *input, uint8_t *output) const {
+            std::vector<uint8_t> scratch(permutation_.size());
+            interleaveBits(input, output, scratch.data());
+        }
+        
+        /**
+         * @brief Deinterleaves a block of bits, packed into bytes (MSB first).
+         *
+         * The block size must be a multiple of 8.
+         */
+        void deinterleaveBits(const uint8_t *input, uint8_t *output) const {
+            assert(input != output);
+            assert(permutation_.size() % 8 == 0);
+            
+            memset(output, 0, permutation_.size() / 8);
+            for (size_t i = 0; i < permutation_.size(); i++) {
+                uint32_t p = permutation_[i];
+                output[p >> 3] |= ((input[i >> 3] >> (7 - (i & 7))) & 1) << (7 - (p & 7));
+            }
+        }
+        
+    };
+    
+    /**
+     * @brief Quadratic permutation polynomial (QPP) interleaver.
+     *
+     * The permutation is (f1 * i + f2 * i * i) mod size, which is the interleaver
+     * used by the LTE turbo code. The parameters must be chosen so that this is
+     * really a permutation, see 3GPP TS 36.212 Table 5.1.3-3 for the LTE values.
+     */
+    class QppInterleaver final : public Interleaver {
+    public:
+        
+        /**
+         * @brief Creates a QPP interleaver with the given block size and parameters.
+         */
+        inline explicit QppInterleaver(uint32_t size, uint32_t f1, uint32_t f2) {
+            assert(size > 0);
+            permutation_.resize(size);
+            
+            // Compute the polynomial incrementally, to avoid overflowing:
+            // p(i + 1) = p(i) + g(i), where g(i) = f1 + f2 * (2i + 1)
+            // and g(i + 1) = g(i) + 2 * f2
+            uint64_t p = 0;
+            uint64_t g = (static_cast<uint64_t>(f1) + f2) % size;
+            const uint64_t g2 = (2 * static_cast<uint64_t>(f2)) % size;
+            for (uint32_t i = 0; i < size; i++) {
+                permutation_[i] = static_cast<uint32_t>(p);
+                p = (p + g) % size;
+                g = (g + g2) % size;
+            }
+            
+            assert(isValid());
+        }
+        
+    };
+    
+    /**
+     * @brief S-random interleaver.
+     *
+     * A pseudo-random permutation in which any two input positions that are
+     * within a distance of spread from each other are mapped to output positions
+     * that are further than spread from each other. The permutation only depends
+     * on the seed, so the transmitter and the receiver can create the same one.
+     *
+     * Finding such a permutation is only feasible when spread is below about
+     * sqrt(size / 2), otherwise std::invalid_argument is thrown.
+     */
+    class SRandomInterleaver final : public Interleaver {
+    
+    private:
+        
+        // Tries to create the permutation, returns false if it got stuck
+        bool tryCreate(uint32_t size, uint32_t spread, std::mt19937 &rng) {
+            std::vector<uint32_t> candidates(size);
+            for (uint32_t i = 0; i < size; i++) {
+                candidates[i] = i;
+            }
+            std::shuffle(candidates.begin(), candidates.end(), rng);
+            
+            permutation_.clear();
+            for (uint32_t i = 0; i < size; i++) {
+                // Find the first candidate that is far enough from the recently chosen ones
+                bool found = false;
+                for (size_t c = 0; c < candidates.size(); c++) {
+                    uint32_t candidate = candidates[c];
+                    bool good = true;
+                    for (uint32_t j = (i > spread) ? (i - spread) : 0; j < i; j++) {
+                        uint32_t other = permutation_[j];
+                        uint32_t distance = (candidate > other) ? (candidate - other) : (other - candidate);
+                        if (distance <= spread) {
+                            good = false;
+                            break;
+                        }
+                    }
+                    
+                    if (good) {
+                        permutation_.push_back(candidate);
+                        candidates[c] = candidates.back();
+                        candidates.pop_back();
+                        found = true;
+                        break;
+                    }
+                }
+                
+                if (!found) {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates an S-random interleaver.
+         *
+         * Parameters:
+         * - size: the block size
+         * - spread: the minimum spread (the S parameter)
+         * - seed: seed of the pseudo-random generator
+         * - maxAttempts: how many times to start over when the search gets stuck
+         */
+        explicit SRandomInterleaver(uint32_t size, uint32_t spread, uint32_t seed = 0, uint32_t maxAttempts = 100) {
+            assert(size > 0);
+            std::mt19937 rng(seed);
+            
+            for (uint32_t attempt = 0; attempt < maxAttempts; attempt++) {
+                if (tryCreate(size, spread, rng)) {
+                    assert(isValid());
+                    return;
+                }
+            }
+            
+            throw std::invalid_argument("SRandomInterleaver: could not find a permutation with the given spread.");
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_INTERLEAVER_H
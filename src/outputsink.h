@@ -0,0 +1,236 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_OUTPUTSINK_H
+#define FECMAGIC_OUTPUTSINK_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace fecmagic {
+
+    // Output sinks
+    // ------------
+    //
+    // The encodeBits() and decodeBits() methods of the encoders and decoders write their
+    // output to a sink instead of a raw buffer. A sink is any class that has this method:
+    //
+    //     void write(const uint8_t *data, size_t size);
+    //
+    // which is called with complete bytes of output, in order.
+
+    /**
+     * @brief Sink that writes to a contiguous buffer.
+     */
+    class BufferSink final {
+        
+    private:
+        
+        uint8_t *buffer_;
+        size_t capacity_;
+        size_t size_;
+        
+    public:
+        
+        explicit BufferSink(void *buffer, size_t capacity)
+            : buffer_(reinterpret_cast<uint8_t*>(buffer)), capacity_(capacity), size_(0) {
+            assert(buffer_ != nullptr || capacity == 0);
+        }
+        
+        inline void write(const uint8_t *data, size_t size) {
+            assert(size_ + size <= capacity_);
+            memcpy(buffer_ + size_, data, size);
+            size_ += size;
+        }
+        
+        /**
+         * @brief Returns the number of bytes written so far.
+         */
+        inline size_t size() const {
+            return size_;
+        }
+        
+        /**
+         * @brief Starts writing from the beginning of the buffer again.
+         */
+        inline void reset() {
+            size_ = 0;
+        }
+        
+    };
+    
+    /**
+     * @brief Sink that passes the output to a callback function.
+     */
+    class CallbackSink final {
+        
+    public:
+        
+        typedef ::std::function<void(const uint8_t *data, size_t size)> Callback;
+        
+    private:
+        
+        Callback callback_;
+        
+    public:
+        
+        explicit CallbackSink(Callback callback)
+            : callback_(::std::move(callback)) {
+            assert(callback_);
+        }
+        
+        inline void write(const uint8_t *data, size_t size) {
+            callback_(data, size);
+        }
+        
+    };
+    
+    /**
+     * @brief Sink that writes to a ring buffer of a fixed capacity.
+     *
+     * The output can be read from the other end of the ring buffer. Writing more
+     * than the free space of the ring buffer is not allowed.
+     */
+    class RingBufferSink final {
+        
+    private:
+        
+        ::std::vector<uint8_t> buffer_;
+        size_t readPos_;
+        size_t size_;
+        
+    public:
+        
+        explicit RingBufferSink(size_t capacity)
+            : buffer_(capacity), readPos_(0), size_(0) {
+            assert(capacity > 0);
+        }
+        
+        inline void write(const uint8_t *data, size_t size) {
+            assert(size <= freeSpace());
+            size_t writePos = (readPos_ + size_) % buffer_.size();
+            size_t first = ::std::min(size, buffer_.size() - writePos);
+            memcpy(buffer_.data() + writePos, data, first);
+            memcpy(buffer_.data(), data + first, size - first);
+            size_ += size;
+        }
+        
+        /**
+         * @brief Reads at most the given number of bytes, returns the number of bytes read.
+         */
+        inline size_t read(void *output, size_t maxSize) {
+            uint8_t *outputBytes = reinterpret_cast<uint8_t*>(output);
+            size_t size = ::std::min(maxSize, size_);
+            size_t first = ::std::min(size, buffer_.size() - readPos_);
+            memcpy(outputBytes, buffer_.data() + readPos_, first);
+            memcpy(outputBytes + first, buffer_.data(), size - first);
+            readPos_ = (readPos_ + size) % buffer_.size();
+            size_ -= size;
+            return size;
+        }
+        
+        /**
+         * @brief Returns the number of bytes that can be read.
+         */
+        inline size_t available() const {
+            return size_;
+        }
+        
+        /**
+         * @brief Returns the number of bytes that can be written.
+         */
+        inline size_t freeSpace() const {
+            return buffer_.size() - size_;
+        }
+        
+        inline size_t capacity() const {
+            return buffer_.size();
+        }
+        
+    };
+    
+    /**
+     * @brief Describes a segment of memory, the same way as struct iovec does.
+     */
+    struct Iovec final {
+        void *base;
+        size_t length;
+    };
+    
+    /**
+     * @brief Sink that scatters the output into a list of memory segments.
+     *
+     * Each segment is filled before moving on to the next one. Writing more
+     * than the total length of the segments is not allowed.
+     */
+    class IovecSink final {
+        
+    private:
+        
+        const Iovec *segments_;
+        size_t count_;
+        size_t index_;
+        size_t offset_;
+        size_t size_;
+        
+    public:
+        
+        explicit IovecSink(const Iovec *segments, size_t count)
+            : segments_(segments), count_(count), index_(0), offset_(0), size_(0) {
+            assert(segments_ != nullptr || count == 0);
+        }
+        
+        inline void write(const uint8_t *data, size_t size) {
+            size_ += size;
+            while (size > 0) {
+                assert(index_ < count_);
+                const Iovec &segment = segments_[index_];
+                size_t n = ::std::min(size, segment.length - offset_);
+                memcpy(reinterpret_cast<uint8_t*>(segment.base) + offset_, data, n);
+                data += n;
+                size -= n;
+                offset_ += n;
+                if (offset_ == segment.length) {
+                    index_++;
+                    offset_ = 0;
+                }
+            }
+        }
+        
+        /**
+         * @brief Returns the number of bytes written so far.
+         */
+        inline size_t size() const {
+            return size_;
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_OUTPUTSINK_H
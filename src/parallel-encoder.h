@@ -0,0 +1,226 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_PARALLEL_ENCODER_H
+#define FECMAGIC_PARALLEL_ENCODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+namespace fecmagic {
+
+    /**
+     * @brief Encodes large buffers on multiple threads.
+     *
+     * The state of a convolutional encoder at any position of the input only depends
+     * on the preceding ConstraintLength bits, so the input is split into chunks that are
+     * encoded independently (see PuncturedConvolutionalEncoder::resetAt). Chunks are a
+     * multiple of the puncturing period long, so each of them starts at the beginning of
+     * the puncturing matrix and at a byte boundary of the output, which means that the
+     * threads never write the same byte. The output is bit-exact with the output of a
+     * single encoder.
+     *
+     * The threads are started by the constructor and are kept until the encoder is destroyed.
+     *
+     * Template parameters:
+     * - TEncoder: the encoder type, such as ConvolutionalEncoder or PuncturedConvolutionalEncoder
+     */
+    template<typename TEncoder>
+    class ParallelEncoder final {
+        
+    private:
+        
+        // Worker threads (the calling thread also works)
+        ::std::vector<::std::thread> threads_;
+        
+        // Chunk size used for the current job
+        size_t minChunkSize_;
+        
+        // Current job
+        const uint8_t *input_ = nullptr;
+        size_t inputSize_ = 0;
+        uint8_t *output_ = nullptr;
+        size_t chunkSize_ = 0;
+        size_t chunkCount_ = 0;
+        
+        // Index of the next chunk to encode
+        ::std::atomic<size_t> nextChunk_;
+        
+        // Synchronization between the caller and the workers
+        ::std::mutex mutex_;
+        ::std::condition_variable jobStarted_;
+        ::std::condition_variable jobFinished_;
+        uint64_t generation_ = 0;
+        uint32_t busyThreads_ = 0;
+        bool stopping_ = false;
+        
+        // Encodes chunks until there are none left
+        void encodeChunks() {
+            for (;;) {
+                size_t chunk = nextChunk_.fetch_add(1);
+                if (chunk >= chunkCount_) {
+                    return;
+                }
+                
+                size_t offset = chunk * chunkSize_;
+                size_t size = ::std::min(chunkSize_, inputSize_ - offset);
+                
+                TEncoder encoder;
+                encoder.resetAt(output_, input_, offset);
+                encoder.encode(input_ + offset, size);
+                if (chunk == chunkCount_ - 1) {
+                    encoder.flush();
+                }
+            }
+        }
+        
+        void worker() {
+            uint64_t seenGeneration = 0;
+            for (;;) {
+                {
+                    ::std::unique_lock<::std::mutex> lock(mutex_);
+                    jobStarted_.wait(lock, [this, seenGeneration]() {
+                        return stopping_ || generation_ != seenGeneration;
+                    });
+                    if (stopping_) {
+                        return;
+                    }
+                    seenGeneration = generation_;
+                }
+                
+                encodeChunks();
+                
+                {
+                    ::std::lock_guard<::std::mutex> lock(mutex_);
+                    busyThreads_--;
+                }
+                jobFinished_.notify_one();
+            }
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates a parallel encoder with the given number of threads.
+         *
+         * Inputs are split into chunks of at least minChunkSize bytes.
+         */
+        explicit ParallelEncoder(uint32_t threadCount = ::std::thread::hardware_concurrency(), size_t minChunkSize = 64 * 1024)
+            : minChunkSize_(minChunkSize), nextChunk_(0) {
+            // The calling thread is one of the threads
+            for (uint32_t i = 1; i < threadCount; i++) {
+                threads_.emplace_back(&ParallelEncoder::worker, this);
+            }
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        ParallelEncoder(const ParallelEncoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        ParallelEncoder &operator=(const ParallelEncoder &other) = delete;
+        
+        ~ParallelEncoder() {
+            {
+                ::std::lock_guard<::std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            jobStarted_.notify_all();
+            for (auto &thread : threads_) {
+                thread.join();
+            }
+        }
+        
+        /**
+         * @brief Returns the number of threads used for encoding.
+         */
+        inline uint32_t threadCount() const {
+            return static_cast<uint32_t>(threads_.size()) + 1;
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            return TEncoder::calculateOutputSize(inputSize);
+        }
+        
+        /**
+         * @brief Encodes and flushes the given input.
+         *
+         * The caller of this method is responsible for making sure that enough memory is
+         * allocated to fit the output. This method is not reentrant: call it from one
+         * thread at a time.
+         */
+        void encode(const void *input, size_t inputSize, void *output) {
+            assert(input != nullptr || inputSize == 0);
+            assert(output != nullptr);
+            
+            // Chunks start at the beginning of the puncturing matrix
+            size_t period = TEncoder::puncturingPeriod();
+            size_t chunkSize = ::std::max(minChunkSize_, inputSize / (threadCount() * 4) + 1);
+            chunkSize = (chunkSize + period - 1) / period * period;
+            
+            input_ = reinterpret_cast<const uint8_t*>(input);
+            inputSize_ = inputSize;
+            output_ = reinterpret_cast<uint8_t*>(output);
+            chunkSize_ = chunkSize;
+            chunkCount_ = (inputSize == 0) ? 1 : (inputSize + chunkSize - 1) / chunkSize;
+            nextChunk_ = 0;
+            
+            // Small inputs are not worth waking up the workers
+            if (chunkCount_ == 1 || threads_.empty()) {
+                encodeChunks();
+                return;
+            }
+            
+            {
+                ::std::lock_guard<::std::mutex> lock(mutex_);
+                busyThreads_ = static_cast<uint32_t>(threads_.size());
+                generation_++;
+            }
+            jobStarted_.notify_all();
+            
+            encodeChunks();
+            
+            ::std::unique_lock<::std::mutex> lock(mutex_);
+            jobFinished_.wait(lock, [this]() {
+                return busyThreads_ == 0;
+            });
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_PARALLEL_ENCODER_H
@@ -0,0 +1,411 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_PUNCTURING_H
+#define FECMAGIC_PUNCTURING_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "fecmagic-global.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Punctures and depunctures bit streams in bulk.
+     *
+     * The puncturing pattern is a periodic sequence of zeroes and ones: bits of the
+     * input where the pattern is zero are left out of the output. Instead of checking
+     * the pattern for every bit, a mask is precomputed for each phase of the pattern,
+     * and 64 bits are compacted at a time using the pext instruction of BMI2 (when
+     * COMPILE_BMI2_CODE is defined and the CPU supports it), or 8 bits at a time
+     * using lookup tables.
+     *
+     * Depuncturing is the reverse: the output gets a zero in place of every left
+     * out bit, and the erasure bitmap marks them so that a decoder can ignore them.
+     *
+     * The phase (index into the pattern of the next bit) is passed to each method,
+     * which makes it possible to process a stream in parts, and also to share one
+     * instance between many streams.
+     * Bits are in MSB first order.
+     */
+    class PuncturingStage final {
+        
+    private:
+        
+        // Length of the pattern
+        size_t count_;
+        
+        // The pattern itself
+        std::vector<uint8_t> pattern_;
+        
+        // Mask of a 64-bit word starting at each phase (MSB is the first bit)
+        std::vector<uint64_t> wordMask_;
+        
+        // Mask of a byte starting at each phase
+        std::vector<uint8_t> byteMask_;
+        
+        // Number of kept bits of a word and of a byte starting at each phase
+        std::vector<uint8_t> wordBits_, byteBits_;
+        
+        // Phase after a word and after a byte starting at each phase
+        std::vector<uint32_t> wordNext_, byteNext_;
+        
+        // Compacted bits of each byte starting at each phase
+        std::vector<uint8_t> compact_;
+        
+        // Expanded bits for the next bits of the input, at each phase
+        std::vector<uint8_t> expand_;
+        
+        // Appends bits to an MSB first bit stream
+        struct BitWriter final {
+            uint8_t *output;
+            size_t addr;
+            uint64_t acc;
+            uint32_t accBits;
+            
+            explicit BitWriter(uint8_t *output, size_t bitOffset)
+                : output(output), addr(bitOffset / 8), acc(0), accBits(bitOffset % 8) {
+                // Keep the bits that are already in the first byte
+                if (accBits != 0) {
+                    acc = output[addr] >> (8 - accBits);
+                }
+            }
+            
+            // Puts at most 32 bits
+            inline void put(uint64_t bits, uint32_t n) {
+                acc = (acc << n) | bits;
+                accBits += n;
+                while (accBits >= 8) {
+                    accBits -= 8;
+                    output[addr++] = static_cast<uint8_t>(acc >> accBits);
+                }
+            }
+            
+            inline void put64(uint64_t bits, uint32_t n) {
+                if (n > 32) {
+                    put(bits >> 32, n - 32);
+                    put(bits & 0xffffffffu, 32);
+                }
+                else {
+                    put(bits, n);
+                }
+            }
+            
+            // Writes the last incomplete byte, the rest of its bits are zero
+            inline void finish() {
+                if (accBits != 0) {
+                    output[addr] = static_cast<uint8_t>(acc << (8 - accBits));
+                }
+            }
+        };
+        
+        // Reads bits from an MSB first bit stream, never reading more bytes than needed
+        struct BitReader final {
+            const uint8_t *input;
+            size_t addr;
+            uint64_t acc;
+            uint32_t accBits;
+            
+            explicit BitReader(const uint8_t *input, size_t bitOffset)
+                : input(input), addr(bitOffset / 8 + (bitOffset % 8 ? 1 : 0)), acc(0), accBits(0) {
+                if (bitOffset % 8) {
+                    accBits = 8 - bitOffset % 8;
+                    acc = input[bitOffset / 8] & ((1u << accBits) - 1);
+                }
+            }
+            
+            // Gets at most 32 bits
+            inline uint64_t get(uint32_t n) {
+                while (accBits < n) {
+                    acc = (acc << 8) | input[addr++];
+                    accBits += 8;
+                }
+                accBits -= n;
+                return (acc >> accBits) & ((static_cast<uint64_t>(1) << n) - 1);
+            }
+            
+            inline uint64_t get64(uint32_t n) {
+                if (n > 32) {
+                    uint64_t hi = get(n - 32);
+                    return (hi << 32) | get(32);
+                }
+                return get(n);
+            }
+        };
+        
+        // Bit by bit puncturing of the bits that don't make up a whole word
+        inline void punctureBits(const uint8_t *input, size_t bitOffset, size_t bitCount, BitWriter &writer, size_t &phase) const {
+            for (size_t i = bitOffset; i < bitOffset + bitCount; i++) {
+                if (pattern_[phase]) {
+                    writer.put((input[i / 8] >> (7 - i % 8)) & 1, 1);
+                }
+                phase = (phase + 1) % count_;
+            }
+        }
+        
+        // Bit by bit depuncturing of the bits that don't make up a whole word
+        inline void depunctureBits(BitReader &reader, size_t bitOffset, size_t bitCount, uint8_t *output, uint8_t *erasures, size_t &phase) const {
+            for (size_t i = bitOffset; i < bitOffset + bitCount; i++) {
+                if (i % 8 == 0) {
+                    output[i / 8] = 0;
+                    erasures[i / 8] = 0;
+                }
+                if (pattern_[phase]) {
+                    output[i / 8] |= static_cast<uint8_t>(reader.get(1) << (7 - i % 8));
+                }
+                else {
+                    erasures[i / 8] |= static_cast<uint8_t>(1 << (7 - i % 8));
+                }
+                phase = (phase + 1) % count_;
+            }
+        }
+        
+        static inline uint64_t loadWord(const uint8_t *p) {
+            uint64_t word = 0;
+            for (uint32_t i = 0; i < 8; i++) {
+                word = (word << 8) | p[i];
+            }
+            return word;
+        }
+        
+        static inline void storeWord(uint8_t *p, uint64_t word) {
+            for (uint32_t i = 0; i < 8; i++) {
+                p[i] = static_cast<uint8_t>(word >> (56 - 8 * i));
+            }
+        }
+        
+        void punctureWordsGeneric(const uint8_t *input, size_t wordCount, BitWriter &writer, size_t &phase) const {
+            for (size_t i = 0; i < wordCount * 8; i++) {
+                writer.put(compact_[phase * 256 + input[i]], byteBits_[phase]);
+                phase = byteNext_[phase];
+            }
+        }
+        
+        void depunctureWordsGeneric(BitReader &reader, size_t wordCount, uint8_t *output, uint8_t *erasures, size_t &phase) const {
+            for (size_t i = 0; i < wordCount * 8; i++) {
+                output[i] = expand_[phase * 256 + reader.get(byteBits_[phase])];
+                erasures[i] = ~byteMask_[phase];
+                phase = byteNext_[phase];
+            }
+        }
+        
+#ifdef COMPILE_BMI2_CODE
+        BMI2_FUNCTION void punctureWordsBmi2(const uint8_t *input, size_t wordCount, BitWriter &writer, size_t &phase) const {
+            for (size_t w = 0; w < wordCount; w++) {
+                writer.put64(_pext_u64(loadWord(input + w * 8), wordMask_[phase]), wordBits_[phase]);
+                phase = wordNext_[phase];
+            }
+        }
+        
+        BMI2_FUNCTION void depunctureWordsBmi2(BitReader &reader, size_t wordCount, uint8_t *output, uint8_t *erasures, size_t &phase) const {
+            for (size_t w = 0; w < wordCount; w++) {
+                uint64_t mask = wordMask_[phase];
+                storeWord(output + w * 8, _pdep_u64(reader.get64(wordBits_[phase]), mask));
+                storeWord(erasures + w * 8, ~mask);
+                phase = wordNext_[phase];
+            }
+        }
+#endif
+        
+    public:
+        
+        /**
+         * @brief Creates a puncturing stage with the given pattern.
+         *
+         * The pattern must contain at least one non-zero element.
+         */
+        template<typename T>
+        explicit PuncturingStage(const T *pattern, size_t count)
+            : count_(count), pattern_(count), wordMask_(count), byteMask_(count),
+              wordBits_(count), byteBits_(count), wordNext_(count), byteNext_(count),
+              compact_(count * 256), expand_(count * 256) {
+            assert(count > 0);
+            
+            bool hasNonZero = false;
+            for (size_t i = 0; i < count; i++) {
+                pattern_[i] = (pattern[i] != 0) ? 1 : 0;
+                hasNonZero = hasNonZero || pattern_[i];
+            }
+            assert(hasNonZero);
+            (void) hasNonZero;
+            
+            for (size_t p = 0; p < count; p++) {
+                wordMask_[p] = 0;
+                for (uint32_t i = 0; i < 64; i++) {
+                    wordMask_[p] |= static_cast<uint64_t>(pattern_[(p + i) % count]) << (63 - i);
+                }
+                byteMask_[p] = static_cast<uint8_t>(wordMask_[p] >> 56);
+                wordBits_[p] = static_cast<uint8_t>(computePopcount(static_cast<unsigned>(wordMask_[p] >> 32)) + computePopcount(static_cast<unsigned>(wordMask_[p])));
+                byteBits_[p] = computePopcount(byteMask_[p]);
+                wordNext_[p] = static_cast<uint32_t>((p + 64) % count);
+                byteNext_[p] = static_cast<uint32_t>((p + 8) % count);
+                
+                for (uint32_t b = 0; b < 256; b++) {
+                    // Keep the bits of b where the mask is set
+                    uint32_t c = 0;
+                    for (int32_t i = 7; i >= 0; i--) {
+                        if ((byteMask_[p] >> i) & 1) {
+                            c = (c << 1) | ((b >> i) & 1);
+                        }
+                    }
+                    compact_[p * 256 + b] = static_cast<uint8_t>(c);
+                    
+                    // Put the low bits of b where the mask is set
+                    uint32_t e = 0;
+                    uint32_t n = byteBits_[p];
+                    for (int32_t i = 7; i >= 0; i--) {
+                        if ((byteMask_[p] >> i) & 1) {
+                            n--;
+                            e |= ((b >> n) & 1) << i;
+                        }
+                    }
+                    expand_[p * 256 + b] = static_cast<uint8_t>(e);
+                }
+            }
+        }
+        
+        /**
+         * @brief Returns the length of the pattern.
+         */
+        inline size_t count() const {
+            return count_;
+        }
+        
+        /**
+         * @brief Returns the number of bits that remain after puncturing the given
+         * number of bits, starting at the given phase.
+         */
+        inline size_t puncturedBitCount(size_t bitCount, size_t phase = 0) const {
+            size_t n = 0;
+            size_t periods = bitCount / count_;
+            if (periods > 0) {
+                for (size_t i = 0; i < count_; i++) {
+                    n += pattern_[i];
+                }
+                n *= periods;
+            }
+            for (size_t i = 0; i < bitCount % count_; i++) {
+                n += pattern_[(phase + i) % count_];
+            }
+            return n;
+        }
+        
+        /**
+         * @brief Punctures the given bits.
+         *
+         * Takes bitCount bits of the input and writes the remaining bits to the output,
+         * starting at the given bit offset. The bits of the output that precede the offset
+         * are kept. The phase is updated.
+         *
+         * Returns the number of bits written.
+         */
+        size_t puncture(const uint8_t *input, size_t bitCount, uint8_t *output, size_t outputBitOffset, size_t &phase) const {
+            assert(input != nullptr);
+            assert(output != nullptr);
+            assert(phase < count_);
+            
+            BitWriter writer(output, outputBitOffset);
+            size_t wordCount = bitCount / 64;
+            
+#ifdef COMPILE_BMI2_CODE
+            if (BMI2_SUPPORTED) {
+                punctureWordsBmi2(input, wordCount, writer, phase);
+            }
+            else
+#endif
+            {
+                punctureWordsGeneric(input, wordCount, writer, phase);
+            }
+            
+            punctureBits(input, wordCount * 64, bitCount % 64, writer, phase);
+            writer.finish();
+            
+            return writer.addr * 8 + writer.accBits - outputBitOffset;
+        }
+        
+        /**
+         * @brief Depunctures the given bits.
+         *
+         * Reads the input from the given bit offset, and writes outputBitCount bits to
+         * the output. Every bit that was left out by puncturing is 0 in the output and 1
+         * in the erasure bitmap. The phase is updated.
+         *
+         * Returns the number of input bits consumed.
+         */
+        size_t depuncture(const uint8_t *input, size_t inputBitOffset, uint8_t *output, uint8_t *erasures, size_t outputBitCount, size_t &phase) const {
+            assert(input != nullptr);
+            assert(output != nullptr);
+            assert(erasures != nullptr);
+            assert(phase < count_);
+            
+            BitReader reader(input, inputBitOffset);
+            size_t consumed = puncturedBitCount(outputBitCount, phase);
+            size_t wordCount = outputBitCount / 64;
+            
+#ifdef COMPILE_BMI2_CODE
+            if (BMI2_SUPPORTED) {
+                depunctureWordsBmi2(reader, wordCount, output, erasures, phase);
+            }
+            else
+#endif
+            {
+                depunctureWordsGeneric(reader, wordCount, output, erasures, phase);
+            }
+            
+            depunctureBits(reader, wordCount * 64, outputBitCount % 64, output, erasures, phase);
+            
+            return consumed;
+        }
+        
+        /**
+         * @brief Depunctures soft values (for example LLRs).
+         *
+         * Writes outputCount values to the output, with 0 (no information)
+         * in place of every value that was left out by puncturing.
+         * The phase is updated.
+         *
+         * Returns the number of input values consumed.
+         */
+        template<typename T>
+        size_t depunctureSoft(const T *input, T *output, size_t outputCount, size_t &phase) const {
+            assert(input != nullptr);
+            assert(output != nullptr);
+            assert(phase < count_);
+            
+            size_t consumed = 0;
+            for (size_t i = 0; i < outputCount; i++) {
+                output[i] = pattern_[phase] ? input[consumed++] : static_cast<T>(0);
+                phase = (phase + 1 == count_) ? 0 : phase + 1;
+            }
+            
+            return consumed;
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_PUNCTURING_H
@@ -0,0 +1,298 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_RATE_COMPATIBLE_PUNCTURING_H
+#define FECMAGIC_RATE_COMPATIBLE_PUNCTURING_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "fecmagic-global.h"
+#include "puncturing.h"
+#include "outputsink.h"
+#include "convolutional-encoder.h"
+#include "convolutional-decoder.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Family of nested puncturing patterns for rate-compatible punctured convolutional (RCPC) codes.
+     *
+     * All patterns have the same period, and they are ordered from the lowest rate to the
+     * highest: each pattern keeps a subset of the bits kept by the previous one. This way,
+     * the bits of a higher rate are always part of a lower rate, so a transmitter can send
+     * additional bits when a lower rate is needed.
+     *
+     * A PuncturingStage is created for each pattern up front, so selecting a rate costs nothing.
+     */
+    class RateCompatiblePuncturingFamily final {
+        
+    private:
+        
+        // Length of the patterns
+        size_t period_;
+        
+        // Puncturing stage of each pattern
+        ::std::vector<PuncturingStage> stages_;
+        
+    public:
+        
+        /**
+         * @brief Tells whether the given patterns are nested.
+         *
+         * The patterns are stored one after the other, each of them has period elements.
+         */
+        template<typename T>
+        static bool isNested(const T *patterns, size_t patternCount, size_t period) {
+            for (size_t p = 1; p < patternCount; p++) {
+                for (size_t i = 0; i < period; i++) {
+                    if (patterns[p * period + i] != 0 && patterns[(p - 1) * period + i] == 0) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+        
+        /**
+         * @brief Creates a family from the given patterns.
+         *
+         * The patterns are stored one after the other, each of them has period elements,
+         * ordered from the lowest rate to the highest. They must be nested.
+         */
+        template<typename T>
+        explicit RateCompatiblePuncturingFamily(const T *patterns, size_t patternCount, size_t period)
+            : period_(period) {
+            assert(patterns != nullptr);
+            assert(patternCount > 0);
+            assert(isNested(patterns, patternCount, period));
+            
+            stages_.reserve(patternCount);
+            for (size_t p = 0; p < patternCount; p++) {
+                stages_.emplace_back(patterns + p * period, period);
+            }
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        RateCompatiblePuncturingFamily(const RateCompatiblePuncturingFamily &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        RateCompatiblePuncturingFamily &operator=(const RateCompatiblePuncturingFamily &other) = delete;
+        
+        /**
+         * @brief Returns the number of patterns (rates) in the family.
+         */
+        inline size_t size() const {
+            return stages_.size();
+        }
+        
+        /**
+         * @brief Returns the length of the patterns.
+         */
+        inline size_t period() const {
+            return period_;
+        }
+        
+        /**
+         * @brief Returns the puncturing stage of the given rate.
+         */
+        inline const PuncturingStage &stage(size_t rateIndex) const {
+            assert(rateIndex < stages_.size());
+            return stages_[rateIndex];
+        }
+        
+    };
+    
+    /**
+     * @brief Encoder for rate-compatible punctured convolutional codes, with the rate selected per frame.
+     *
+     * Each frame is encoded with the mother code (starting from the 0 state and flushed at
+     * the end), then punctured with the pattern of the selected rate.
+     *
+     * Template parameters are the same as for ConvolutionalEncoder.
+     */
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    class RateCompatibleConvolutionalEncoder final {
+        
+    private:
+        
+        typedef ConvolutionalEncoder<ConstraintLength, TShiftReg, Polynomials...> MotherEncoder;
+        
+        // The puncturing patterns
+        const RateCompatiblePuncturingFamily &family_;
+        
+        // Encoder of the mother code
+        MotherEncoder encoder_;
+        
+        // Output of the mother code
+        ::std::vector<uint8_t> motherOutput_;
+        
+    public:
+        
+        /**
+         * @brief Creates an encoder with the given family of puncturing patterns.
+         *
+         * The family must outlive the encoder.
+         */
+        explicit RateCompatibleConvolutionalEncoder(const RateCompatiblePuncturingFamily &family)
+            : family_(family) { }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        RateCompatibleConvolutionalEncoder(const RateCompatibleConvolutionalEncoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        RateCompatibleConvolutionalEncoder &operator=(const RateCompatibleConvolutionalEncoder &other) = delete;
+        
+        /**
+         * @brief Returns the number of encoded bits of a frame of the given size, at the given rate.
+         */
+        inline size_t calculateSymbolCount(size_t inputSize, size_t rateIndex) const {
+            return family_.stage(rateIndex).puncturedBitCount(MotherEncoder::calculateSymbolCount(inputSize));
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a frame of the given size, at the given rate.
+         */
+        inline size_t calculateOutputSize(size_t inputSize, size_t rateIndex) const {
+            return (calculateSymbolCount(inputSize, rateIndex) + 7) / 8;
+        }
+        
+        /**
+         * @brief Encodes a frame at the given rate.
+         *
+         * Returns the number of bits written to the output.
+         */
+        size_t encodeFrame(const void *input, size_t inputSize, size_t rateIndex, void *output) {
+            assert(input != nullptr || inputSize == 0);
+            assert(output != nullptr);
+            
+            size_t motherBits = MotherEncoder::calculateSymbolCount(inputSize);
+            motherOutput_.resize(MotherEncoder::calculateOutputSize(inputSize));
+            
+            encoder_.reset(motherOutput_.data());
+            encoder_.encode(input, inputSize);
+            encoder_.flush();
+            
+            size_t phase = 0;
+            return family_.stage(rateIndex).puncture(motherOutput_.data(), motherBits, reinterpret_cast<uint8_t*>(output), 0, phase);
+        }
+        
+    };
+    
+    /**
+     * @brief Decoder for rate-compatible punctured convolutional codes, with the rate selected per frame.
+     *
+     * Each frame is depunctured with the pattern of the selected rate (the punctured bits
+     * become erasures), then decoded with the Viterbi decoder of the mother code.
+     *
+     * Template parameters are the same as for ConvolutionalDecoder.
+     */
+    template<uint32_t Depth, uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    class RateCompatibleConvolutionalDecoder final {
+        
+    private:
+        
+        typedef ConvolutionalEncoder<ConstraintLength, TShiftReg, Polynomials...> MotherEncoder;
+        
+        // The puncturing patterns
+        const RateCompatiblePuncturingFamily &family_;
+        
+        // Decoder of the mother code
+        ConvolutionalDecoder<Depth, ConstraintLength, TShiftReg, Polynomials...> decoder_;
+        
+        // Depunctured input and its erasures
+        ::std::vector<uint8_t> motherInput_, erasures_;
+        
+        // Decoded output, including the flushed bits
+        ::std::vector<uint8_t> decoded_;
+        
+    public:
+        
+        /**
+         * @brief Creates a decoder with the given family of puncturing patterns.
+         *
+         * The family must outlive the decoder.
+         */
+        explicit RateCompatibleConvolutionalDecoder(const RateCompatiblePuncturingFamily &family)
+            : family_(family) { }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        RateCompatibleConvolutionalDecoder(const RateCompatibleConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        RateCompatibleConvolutionalDecoder &operator=(const RateCompatibleConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Returns the number of encoded bits of a frame of the given size, at the given rate.
+         */
+        inline size_t calculateSymbolCount(size_t outputSize, size_t rateIndex) const {
+            return family_.stage(rateIndex).puncturedBitCount(MotherEncoder::calculateSymbolCount(outputSize));
+        }
+        
+        /**
+         * @brief Decodes a frame that was encoded at the given rate.
+         *
+         * The output size is the size of the frame before encoding, the input
+         * has calculateSymbolCount(outputSize, rateIndex) bits.
+         */
+        void decodeFrame(const void *input, size_t outputSize, size_t rateIndex, void *output) {
+            assert(input != nullptr);
+            assert(output != nullptr || outputSize == 0);
+            
+            size_t motherBits = MotherEncoder::calculateSymbolCount(outputSize);
+            size_t motherSize = (motherBits + 7) / 8;
+            motherInput_.resize(motherSize);
+            erasures_.resize(motherSize);
+            decoded_.resize((motherBits / sizeof...(Polynomials) + 7) / 8 + 1);
+            
+            size_t phase = 0;
+            family_.stage(rateIndex).depuncture(reinterpret_cast<const uint8_t*>(input), 0, motherInput_.data(), erasures_.data(), motherBits, phase);
+            
+            BufferSink sink(decoded_.data(), decoded_.size());
+            decoder_.reset(nullptr);
+            decoder_.decodeBits(motherInput_.data(), 0, motherBits, erasures_.data(), sink);
+            decoder_.flushBits(sink);
+            
+            memcpy(output, decoded_.data(), outputSize);
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_RATE_COMPATIBLE_PUNCTURING_H
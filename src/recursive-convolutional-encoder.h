@@ -0,0 +1,319 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_RECURSIVE_CONVOLUTIONAL_ENCODER_H
+#define FECMAGIC_RECURSIVE_CONVOLUTIONAL_ENCODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+
+#include "fecmagic-global.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Encoder that produces recursive systematic convolutional (RSC) code.
+     *
+     * For every input bit, the encoder outputs the input bit itself (the systematic
+     * bit) followed by one parity bit for each feed-forward polynomial. Unlike
+     * PuncturedConvolutionalEncoder, the bit shifted into the register is the input
+     * bit plus the feedback computed from the register. RSC codes are used as
+     * the constituent codes of turbo codes.
+     *
+     * The polynomials use the same convention as PuncturedConvolutionalEncoder:
+     * bit (ConstraintLength - 1) corresponds to the bit that is being shifted in,
+     * and the lower bits to the previous ones. For example, the LTE turbo code
+     * uses FeedbackPolynomial = 0xb and FeedforwardPolynomials = 0xd.
+     *
+     * The encoder is table-driven: it processes a whole input byte with a single
+     * table lookup for each output, so the tables have (2 ^ (ConstraintLength - 1)) * 256
+     * entries.
+     *
+     * Template parameters:
+     * - ConstraintLength: the constraint length of the code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - FeedbackPolynomial: the polynomial that computes the feedback
+     * - FeedforwardPolynomials: the polynomials that compute the parity outputs
+     */
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg ...FeedforwardPolynomials>
+    class RecursiveSystematicConvolutionalEncoder final {
+        // Check template parameters using static asserts
+        static_assert((sizeof(TShiftReg) * 8) >= ConstraintLength, "The shift register must be able to hold the constraint length of the code.");
+        static_assert(ConstraintLength >= 2, "The ConstraintLength template parameter must be at least two.");
+        static_assert(ConstraintLength <= 9, "The tables of the encoder would be too large for this ConstraintLength.");
+        static_assert(((FeedbackPolynomial >> (ConstraintLength - 1)) & 1) == 1, "The feedback polynomial must contain the bit that is being shifted in.");
+        static_assert(sizeof...(FeedforwardPolynomials) >= 1, "There must be at least one feed-forward polynomial.");
+        static_assert(sizeof...(FeedforwardPolynomials) <= 7, "There can be at most seven feed-forward polynomials.");
+        
+    public:
+        
+        // Number of possible encoder states
+        constexpr static uint32_t stateCount = (1 << (ConstraintLength - 1));
+        
+        // Number of parity outputs
+        constexpr static uint32_t parityCount = sizeof...(FeedforwardPolynomials);
+        
+        // Number of outputs (the systematic output and the parity outputs)
+        constexpr static uint32_t outputCount = 1 + parityCount;
+        
+    private:
+        
+        // Unpack variadic template argument, to allow access to each polynomial
+        constexpr static TShiftReg feedforwardPolynomials_[sizeof...(FeedforwardPolynomials)] = { FeedforwardPolynomials... };
+        
+        // Tables that allow encoding a byte at a time
+        struct Tables final {
+            // Next state for each state and input byte
+            TShiftReg nextState[stateCount][256];
+            
+            // Parity bytes for each state and input byte
+            uint8_t parity[stateCount][256][parityCount];
+            
+            // Spreads the bits of a byte so that there are (outputCount - 1) zeroes
+            // between them, used for interleaving the outputs
+            uint64_t spread[256];
+            
+            explicit Tables() {
+                for (uint32_t s = 0; s < stateCount; s++) {
+                    for (uint32_t b = 0; b < 256; b++) {
+                        TShiftReg state = s;
+                        uint8_t parityBits[parityCount];
+                        for (uint32_t o = 0; o < parityCount; o++) {
+                            parity[s][b][o] = 0;
+                        }
+                        
+                        for (uint32_t i = 0; i < 8; i++) {
+                            state = step(state, (b >> (7 - i)) & 1, parityBits);
+                            for (uint32_t o = 0; o < parityCount; o++) {
+                                parity[s][b][o] = (parity[s][b][o] << 1) | parityBits[o];
+                            }
+                        }
+                        
+                        nextState[s][b] = state;
+                    }
+                }
+                
+                for (uint32_t b = 0; b < 256; b++) {
+                    spread[b] = 0;
+                    for (uint32_t i = 0; i < 8; i++) {
+                        spread[b] |= static_cast<uint64_t>((b >> (7 - i)) & 1) << (8 * outputCount - 1 - i * outputCount);
+                    }
+                }
+            }
+        };
+        
+        // Returns the tables, which are created when they are first needed
+        static inline const Tables &tables() {
+            static const Tables t;
+            return t;
+        }
+        
+        // Output
+        uint8_t *output;
+        
+        // Output position
+        size_t outAddr;
+        uint32_t outBitPos;
+        
+        // The state of the encoder (the shift register without the current bit)
+        TShiftReg state;
+        
+        // Puts the given number of bits (MSB first) to the output
+        inline void putBits(uint64_t bits, uint32_t count) {
+            while (count > 0) {
+                if (outBitPos == 7) {
+                    output[outAddr] = 0;
+                }
+                
+                count--;
+                output[outAddr] |= ((bits >> count) & 1) << outBitPos;
+                
+                // Advance output bit position
+                if (outBitPos == 0) {
+                    outAddr++;
+                    outBitPos = 7;
+                }
+                else {
+                    outBitPos--;
+                }
+            }
+        }
+        
+    public:
+        
+        /**
+         * @brief Advances the given state by one input bit.
+         *
+         * Returns the next state and puts the parity bits into the parity array.
+         * This is the bit-by-bit definition of the code, which the tables are created from.
+         */
+        static inline TShiftReg step(TShiftReg state, uint8_t inputBit, uint8_t *parity) {
+            assert(inputBit == (inputBit & 1));
+            assert(state < stateCount);
+            
+            // The bit that is shifted in is the input bit plus the feedback
+            TShiftReg shifted = inputBit ^ ::fecmagic::computeParity(FeedbackPolynomial & state);
+            TShiftReg shiftReg = state | (shifted << (ConstraintLength - 1));
+            
+            for (uint32_t o = 0; o < parityCount; o++) {
+                parity[o] = ::fecmagic::computeParity(feedforwardPolynomials_[o] & shiftReg);
+            }
+            
+            return shiftReg >> 1;
+        }
+        
+        /**
+         * @brief Returns the input bit that drives the encoder towards the zero state.
+         *
+         * This is the input used for trellis termination: it cancels the feedback,
+         * so after (ConstraintLength - 1) such bits, the encoder is in the zero state.
+         */
+        static inline uint8_t terminationBit(TShiftReg state) {
+            return ::fecmagic::computeParity(FeedbackPolynomial & state);
+        }
+        
+        /**
+         * @brief Encodes a byte (MSB first) starting from the given state.
+         *
+         * Advances the state and puts one parity byte for each feed-forward polynomial
+         * into the parity array, using a single table lookup.
+         */
+        static inline void encodeByte(TShiftReg &state, uint8_t input, uint8_t *parity) {
+            const Tables &t = tables();
+            for (uint32_t o = 0; o < parityCount; o++) {
+                parity[o] = t.parity[state][input][o];
+            }
+            state = t.nextState[state][input];
+        }
+        
+        /**
+         * @brief Creates an RSC encoder
+         */
+        explicit RecursiveSystematicConvolutionalEncoder(void *output = nullptr) {
+            this->reset(output);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        RecursiveSystematicConvolutionalEncoder(const RecursiveSystematicConvolutionalEncoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        RecursiveSystematicConvolutionalEncoder &operator=(const RecursiveSystematicConvolutionalEncoder &other) = delete;
+        
+        /**
+         * @brief Resets the encoder and sets the given output.
+         */
+        void reset(void *output) {
+            this->output = reinterpret_cast<uint8_t*>(output);
+            this->state = 0;
+            this->outAddr = 0;
+            this->outBitPos = 7;
+        }
+        
+        /**
+         * @brief Returns the current state of the encoder.
+         */
+        inline TShiftReg currentState() const {
+            return state;
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         *
+         * Output size: give space to encoded bits and the termination bits.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            size_t outputBits = ((inputSize * 8) + (ConstraintLength - 1)) * outputCount;
+            return (outputBits / 8) + ((outputBits % 8) ? 1 : 0);
+        }
+        
+        /**
+         * @brief Encodes the given block.
+         *
+         * Encodes the block of supplied input bytes. The caller of this method is
+         * responsible for making sure that enough memory is allocated to fit the output.
+         *
+         * This method is suitable for streaming.
+         */
+        void encode(const void *input, size_t inputSize) {
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            assert(inputSize == 0 || inputBytes != nullptr);
+            assert(inputSize == 0 || output != nullptr);
+            
+            const Tables &t = tables();
+            
+            for (size_t i = 0; i < inputSize; i++) {
+                uint8_t b = inputBytes[i];
+                const uint8_t *parity = t.parity[state][b];
+                state = t.nextState[state][b];
+                
+                // Interleave the systematic bits with the parity bits
+                uint64_t bits = t.spread[b];
+                for (uint32_t o = 0; o < parityCount; o++) {
+                    bits |= t.spread[parity[o]] >> (o + 1);
+                }
+                
+                if (outBitPos == 7) {
+                    // Every byte of input produces whole bytes of output
+                    for (uint32_t j = 0; j < outputCount; j++) {
+                        output[outAddr++] = static_cast<uint8_t>(bits >> (8 * (outputCount - 1 - j)));
+                    }
+                }
+                else {
+                    putBits(bits, 8 * outputCount);
+                }
+            }
+        }
+        
+        /**
+         * @brief Terminates the trellis, outputting the bits that drive the encoder to the zero state.
+         */
+        void flush() {
+            uint8_t parity[parityCount];
+            
+            for (uint32_t i = 0; i < (ConstraintLength - 1); i++) {
+                uint8_t in = terminationBit(state);
+                state = step(state, in, parity);
+                
+                putBits(in, 1);
+                for (uint32_t o = 0; o < parityCount; o++) {
+                    putBits(parity[o], 1);
+                }
+            }
+            
+            assert(state == 0);
+        }
+        
+    };
+    
+    // Definition for the static member RecursiveSystematicConvolutionalEncoder::feedforwardPolynomials_
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg ...FeedforwardPolynomials>
+    constexpr TShiftReg RecursiveSystematicConvolutionalEncoder<ConstraintLength, TShiftReg, FeedbackPolynomial, FeedforwardPolynomials...>::feedforwardPolynomials_[sizeof...(FeedforwardPolynomials)];
+
+}
+
+#endif // FECMAGIC_RECURSIVE_CONVOLUTIONAL_ENCODER_H
@@ -0,0 +1,513 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_SECDED_H
+#define FECMAGIC_SECDED_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "fecmagic-global.h"
+#include "binarymatrix.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Result of checking a word protected by SecdedCode.
+     */
+    enum class SecdedResult {
+        // The word and its check byte are intact
+        NoError,
+        
+        // A single bit error (in the word or in the check byte) was corrected
+        Corrected,
+        
+        // A double bit error (or worse) was detected, nothing was changed
+        Uncorrectable
+    };
+    
+    /**
+     * @brief Summary of checking a buffer of words protected by SecdedCode.
+     */
+    struct SecdedSummary {
+        // Number of words in which a single bit error was corrected
+        size_t corrected;
+        // Number of words with uncorrectable errors
+        size_t uncorrectable;
+    };
+
+    /**
+     * @brief Hamming(72, 64) single error correcting, double error detecting (SECDED) code.
+     *
+     * Protects 64-bit words with 8 check bits, as ECC memory does. The check bytes
+     * are stored separately from the words, so that the protected data keeps its layout.
+     * It is a Hsiao code: the column of every data bit in the parity check matrix has an
+     * odd weight (3 or 5), so a single bit error has an odd weight syndrome that tells
+     * which bit to flip, and a double bit error has an even weight, nonzero syndrome.
+     *
+     * The check bytes are computed with lookup tables for each byte of the word, which
+     * are split into nibbles for pshufb to check 16 words at a time where SSSE3 is available.
+     */
+    class SecdedCode final {
+        
+    private:
+        
+        // Marks syndromes that don't belong to single bit errors
+        static constexpr uint8_t NoErrorPosition = 0xff;
+        
+        // Tables of the code, computed from the parity check matrix
+        struct Tables final {
+            // Check byte of each byte value at each byte position of the word
+            uint8_t byteChecks[8][256];
+            
+            // Check byte of each nibble value at each nibble position of the word
+            alignas(16) uint8_t nibbleChecks[16][16];
+            
+            // Position of the flipped bit (0-63: word, 64-71: check byte) of each syndrome
+            uint8_t errorPositions[256];
+            
+            explicit Tables() {
+                const BinaryMatrix<8, 64> &matrix = checkMatrix();
+                
+                for (unsigned p = 0; p < 8; p++) {
+                    for (unsigned v = 0; v < 256; v++) {
+                        byteChecks[p][v] = matrix.calculateProduct<uint64_t, uint8_t>(static_cast<uint64_t>(v) << (8 * p));
+                    }
+                }
+                for (unsigned p = 0; p < 16; p++) {
+                    for (unsigned v = 0; v < 16; v++) {
+                        nibbleChecks[p][v] = matrix.calculateProduct<uint64_t, uint8_t>(static_cast<uint64_t>(v) << (4 * p));
+                    }
+                }
+                
+                std::memset(errorPositions, NoErrorPosition, sizeof(errorPositions));
+                for (unsigned i = 0; i < 64; i++) {
+                    errorPositions[matrix.calculateProduct<uint64_t, uint8_t>(static_cast<uint64_t>(1) << i)] = static_cast<uint8_t>(i);
+                }
+                for (unsigned k = 0; k < 8; k++) {
+                    errorPositions[1 << k] = static_cast<uint8_t>(64 + k);
+                }
+            }
+        };
+        
+        static inline const Tables &tables() {
+            static const Tables t;
+            return t;
+        }
+        
+        // Builds the parity check matrix (of the data bits): the columns are all
+        // the bytes of weight 3 in increasing order, then the first 8 bytes of weight 5
+        static inline BinaryMatrix<8, 64> createCheckMatrix() {
+            BinaryMatrix<8, 64> matrix;
+            unsigned i = 0;
+            for (unsigned weight = 3; weight <= 5; weight += 2) {
+                for (unsigned column = 0; column < 256 && i < 64; column++) {
+                    if (computePopcount(column) != weight) {
+                        continue;
+                    }
+                    for (unsigned k = 0; k < 8; k++) {
+                        // Row 0 is the MSB of the check byte, column 0 is the MSB of the word
+                        matrix.setBit(7 - k, 63 - i, (column >> k) & 1);
+                    }
+                    i++;
+                }
+            }
+            return matrix;
+        }
+        
+        // Fixes the word or check byte with the given syndrome, and records the result
+        inline void correctWord(uint64_t &word, uint8_t &check, uint8_t syndrome, size_t index, SecdedSummary &summary, uint8_t *status) const {
+            if (syndrome == 0) {
+                return;
+            }
+            
+            uint8_t position = tables().errorPositions[syndrome];
+            if (position == NoErrorPosition) {
+                summary.uncorrectable++;
+                if (status != nullptr) {
+                    status[index / 8] |= static_cast<uint8_t>(0x80 >> (index % 8));
+                }
+            }
+            else {
+                if (position < 64) {
+                    word ^= static_cast<uint64_t>(1) << position;
+                }
+                else {
+                    check ^= static_cast<uint8_t>(1 << (position - 64));
+                }
+                summary.corrected++;
+            }
+        }
+        
+#ifdef COMPILE_SSSE3_CODE
+        // Computes the check bytes of 16 words
+        SSSE3_FUNCTION
+        static inline __m128i calculateChecksSsse3(const Tables &t, const uint64_t *words) {
+            // Pair up the bytes of each two words, then transpose the pairs,
+            // so that each register holds one byte position of the 16 words
+            const __m128i interleave = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+            __m128i r[8];
+            for (unsigned k = 0; k < 8; k++) {
+                r[k] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + 2 * k)), interleave);
+            }
+            __m128i u[8];
+            for (unsigned k = 0; k < 8; k += 2) {
+                u[k] = _mm_unpacklo_epi16(r[k], r[k + 1]);
+                u[k + 1] = _mm_unpackhi_epi16(r[k], r[k + 1]);
+            }
+            __m128i v[8] = {
+                _mm_unpacklo_epi32(u[0], u[2]), _mm_unpackhi_epi32(u[0], u[2]),
+                _mm_unpacklo_epi32(u[1], u[3]), _mm_unpackhi_epi32(u[1], u[3]),
+                _mm_unpacklo_epi32(u[4], u[6]), _mm_unpackhi_epi32(u[4], u[6]),
+                _mm_unpacklo_epi32(u[5], u[7]), _mm_unpackhi_epi32(u[5], u[7]),
+            };
+            __m128i bytes[8] = {
+                _mm_unpacklo_epi64(v[0], v[4]), _mm_unpackhi_epi64(v[0], v[4]),
+                _mm_unpacklo_epi64(v[1], v[5]), _mm_unpackhi_epi64(v[1], v[5]),
+                _mm_unpacklo_epi64(v[2], v[6]), _mm_unpackhi_epi64(v[2], v[6]),
+                _mm_unpacklo_epi64(v[3], v[7]), _mm_unpackhi_epi64(v[3], v[7]),
+            };
+            
+            // Look up the check bytes of both nibbles of every byte
+            const __m128i mask = _mm_set1_epi8(0x0f);
+            __m128i checks = _mm_setzero_si128();
+            for (unsigned p = 0; p < 8; p++) {
+                __m128i low = _mm_and_si128(bytes[p], mask);
+                __m128i high = _mm_and_si128(_mm_srli_epi16(bytes[p], 4), mask);
+                checks = _mm_xor_si128(checks, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.nibbleChecks[2 * p])), low));
+                checks = _mm_xor_si128(checks, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.nibbleChecks[2 * p + 1])), high));
+            }
+            return checks;
+        }
+        
+        SSSE3_FUNCTION
+        inline size_t encodeBufferSsse3(const uint64_t *words, size_t count, uint8_t *checks) const {
+            const Tables &t = tables();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(checks + i), calculateChecksSsse3(t, words + i));
+            }
+            return i;
+        }
+        
+        SSSE3_FUNCTION
+        inline size_t correctBufferSsse3(uint64_t *words, uint8_t *checks, size_t count, SecdedSummary &summary, uint8_t *status) const {
+            const Tables &t = tables();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i syndromes = _mm_xor_si128(calculateChecksSsse3(t, words + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(checks + i)));
+                unsigned clean = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(syndromes, _mm_setzero_si128())));
+                
+                // Errors are rare, so only the words that have them are looked at one by one
+                if (clean != 0xffff) {
+                    alignas(16) uint8_t s[16];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(s), syndromes);
+                    for (unsigned l = 0; l < 16; l++) {
+                        correctWord(words[i + l], checks[i + l], s[l], i + l, summary, status);
+                    }
+                }
+            }
+            return i;
+        }
+#endif
+        
+    public:
+        
+        /**
+         * @brief Gets the parity check matrix of the data bits.
+         *
+         * Row 0 belongs to the MSB of the check byte, column 0 to the MSB of the word.
+         * The check bits themselves have unit columns, which are not part of this matrix.
+         */
+        static inline const BinaryMatrix<8, 64> &checkMatrix() {
+            static const BinaryMatrix<8, 64> m = createCheckMatrix();
+            return m;
+        }
+        
+        /**
+         * @brief Computes the check byte of a word.
+         */
+        inline uint8_t encode(uint64_t word) const {
+            const Tables &t = tables();
+            uint8_t check = 0;
+            for (unsigned p = 0; p < 8; p++) {
+                check ^= t.byteChecks[p][static_cast<uint8_t>(word >> (8 * p))];
+            }
+            return check;
+        }
+        
+        /**
+         * @brief Checks a word and its check byte, and corrects a single bit error in either of them.
+         */
+        inline SecdedResult correct(uint64_t &word, uint8_t &check) const {
+            SecdedSummary summary = { 0, 0 };
+            correctWord(word, check, encode(word) ^ check, 0, summary, nullptr);
+            return summary.uncorrectable ? SecdedResult::Uncorrectable : (summary.corrected ? SecdedResult::Corrected : SecdedResult::NoError);
+        }
+        
+        /**
+         * @brief Computes the check bytes of a buffer of words.
+         */
+        inline void encodeBuffer(const uint64_t *words, size_t count, uint8_t *checks) const {
+            size_t i = 0;
+            
+#ifdef COMPILE_SSSE3_CODE
+            if (SSSE3_SUPPORTED) {
+                i = encodeBufferSsse3(words, count, checks);
+            }
+#endif
+            
+            for (; i < count; i++) {
+                checks[i] = encode(words[i]);
+            }
+        }
+        
+        /**
+         * @brief Checks a buffer of words and their check bytes, and corrects single bit errors in place.
+         *
+         * When a status bitmap of (count + 7) / 8 bytes is given, the bit of each word
+         * (MSB first) is set when it has an uncorrectable error.
+         */
+        inline SecdedSummary correctBuffer(uint64_t *words, uint8_t *checks, size_t count, uint8_t *status = nullptr) const {
+            SecdedSummary summary = { 0, 0 };
+            size_t i = 0;
+            
+            if (status != nullptr) {
+                std::memset(status, 0, (count + 7) / 8);
+            }
+            
+#ifdef COMPILE_SSSE3_CODE
+            if (SSSE3_SUPPORTED) {
+                i = correctBufferSsse3(words, checks, count, summary, status);
+            }
+#endif
+            
+            for (; i < count; i++) {
+                correctWord(words[i], checks[i], encode(words[i]) ^ checks[i], i, summary, status);
+            }
+            
+            return summary;
+        }
+        
+    };
+    
+    /**
+     * @brief Scrubs a buffer protected by SecdedCode on a background thread.
+     *
+     * Walks the buffer over and over again, limited to the given bandwidth (bytes of words
+     * and check bytes per second), corrects single bit errors in place, and calls the given
+     * function with the index of every word that has an uncorrectable error, on every pass
+     * until the application rewrites that word.
+     *
+     * The scrubber can be locked like a mutex (eg. with std::lock_guard), which pauses it.
+     * Hold the lock while writing the buffer, and update the check bytes of the changed
+     * words before unlocking.
+     *
+     * The thread is started by the constructor and is stopped when the scrubber is destroyed.
+     */
+    class SecdedScrubber final {
+        
+    private:
+        
+        // Number of words checked while the buffer is locked
+        static constexpr size_t ChunkWords = 512;
+        
+        SecdedCode code_;
+        
+        // The protected buffer
+        uint64_t *words_;
+        uint8_t *checks_;
+        size_t count_;
+        
+        // Called with the index of words with uncorrectable errors
+        std::function<void(size_t)> onUncorrectable_;
+        
+        // Statistics
+        std::atomic<uint64_t> correctedCount_;
+        std::atomic<uint64_t> uncorrectableCount_;
+        std::atomic<uint64_t> passCount_;
+        
+        // Held while a chunk of the buffer is scrubbed
+        std::mutex bufferMutex_;
+        
+        // Synchronization between the caller and the thread
+        std::mutex mutex_;
+        std::condition_variable wakeUp_;
+        double bytesPerSecond_;
+        bool bandwidthChanged_ = false;
+        bool stopping_ = false;
+        
+        std::thread thread_;
+        
+        void worker() {
+            typedef std::chrono::steady_clock Clock;
+            Clock::time_point start = Clock::now();
+            double scrubbedBytes = 0;
+            size_t position = 0;
+            
+            for (;;) {
+                // Pace the scrubbing, and wait for being stopped
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    if (bandwidthChanged_) {
+                        bandwidthChanged_ = false;
+                        start = Clock::now();
+                        scrubbedBytes = 0;
+                    }
+                    Clock::time_point next = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(scrubbedBytes / bytesPerSecond_));
+                    if (count_ == 0) {
+                        wakeUp_.wait(lock, [this]() { return stopping_; });
+                    }
+                    else {
+                        wakeUp_.wait_until(lock, next, [this]() { return stopping_ || bandwidthChanged_; });
+                    }
+                    if (stopping_) {
+                        return;
+                    }
+                    if (bandwidthChanged_) {
+                        continue;
+                    }
+                }
+                
+                size_t n = std::min(static_cast<size_t>(ChunkWords), count_ - position);
+                uint8_t status[ChunkWords / 8];
+                SecdedSummary summary;
+                {
+                    std::lock_guard<std::mutex> lock(bufferMutex_);
+                    summary = code_.correctBuffer(words_ + position, checks_ + position, n, status);
+                }
+                
+                correctedCount_ += summary.corrected;
+                uncorrectableCount_ += summary.uncorrectable;
+                if (summary.uncorrectable != 0 && onUncorrectable_) {
+                    for (size_t i = 0; i < n; i++) {
+                        if (status[i / 8] & (0x80 >> (i % 8))) {
+                            onUncorrectable_(position + i);
+                        }
+                    }
+                }
+                
+                scrubbedBytes += static_cast<double>(n * (sizeof(uint64_t) + 1));
+                position += n;
+                if (position == count_) {
+                    position = 0;
+                    passCount_++;
+                }
+            }
+        }
+        
+    public:
+        
+        /**
+         * @brief Starts scrubbing the given words and their check bytes.
+         */
+        explicit SecdedScrubber(uint64_t *words, uint8_t *checks, size_t count, double bytesPerSecond, std::function<void(size_t)> onUncorrectable = nullptr)
+            : words_(words), checks_(checks), count_(count), onUncorrectable_(onUncorrectable),
+              correctedCount_(0), uncorrectableCount_(0), passCount_(0), bytesPerSecond_(bytesPerSecond) {
+            assert(bytesPerSecond > 0);
+            assert(count == 0 || (words != nullptr && checks != nullptr));
+            thread_ = std::thread(&SecdedScrubber::worker, this);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        SecdedScrubber(const SecdedScrubber &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        SecdedScrubber &operator=(const SecdedScrubber &other) = delete;
+        
+        ~SecdedScrubber() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wakeUp_.notify_all();
+            thread_.join();
+        }
+        
+        /**
+         * @brief Pauses scrubbing, so that the buffer can be written.
+         */
+        inline void lock() {
+            bufferMutex_.lock();
+        }
+        
+        /**
+         * @brief Resumes scrubbing.
+         */
+        inline void unlock() {
+            bufferMutex_.unlock();
+        }
+        
+        /**
+         * @brief Changes the bandwidth (bytes per second) of scrubbing.
+         */
+        inline void setBandwidth(double bytesPerSecond) {
+            assert(bytesPerSecond > 0);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                bytesPerSecond_ = bytesPerSecond;
+                bandwidthChanged_ = true;
+            }
+            wakeUp_.notify_all();
+        }
+        
+        /**
+         * @brief Number of single bit errors corrected so far.
+         */
+        inline uint64_t correctedCount() const {
+            return correctedCount_;
+        }
+        
+        /**
+         * @brief Number of uncorrectable errors found so far (counted on every pass).
+         */
+        inline uint64_t uncorrectableCount() const {
+            return uncorrectableCount_;
+        }
+        
+        /**
+         * @brief Number of complete passes over the buffer so far.
+         */
+        inline uint64_t passCount() const {
+            return passCount_;
+        }
+        
+    };
+
+}
+
+#endif // FECMAGIC_SECDED_H
@@ -79,6 +79,15 @@ namespace fecmagic {
             index = count - 1;
         }
         
+        // Index of the number that the next call to next() returns
+        inline size_t phase() const {
+            return (index + 1) % count;
+        }
+        
+        inline void setPhase(size_t phase) {
+            index = (phase + count - 1) % count;
+        }
+        
         
     };
     
@@ -0,0 +1,350 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_THRESHOLD_DECODER_H
+#define FECMAGIC_THRESHOLD_DECODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+
+#include "fecmagic-global.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Majority-logic (threshold) decoder for self-orthogonal systematic convolutional codes.
+     *
+     * One of the polynomials must be systematic (contain only the bit being shifted in),
+     * the others are parity polynomials. The decoder re-encodes the received information
+     * bits and keeps the syndrome (received parity XOR re-encoded parity) of each parity
+     * output in a shift register. When the code is self-orthogonal (the differences of the
+     * tap positions of all parity polynomials are distinct), each tap of a parity polynomial
+     * gives a parity check that contains the oldest information bit in the register, and no
+     * other error is contained in more than one of them. So the oldest bit is flipped when
+     * more than half of the J checks fail, and its effect is removed from the syndromes
+     * (feedback decoding). Up to J/2 errors are corrected within ConstraintLength steps.
+     *
+     * This only takes a few XOR and popcount operations per bit, and the decoding delay is
+     * ConstraintLength - 1 steps (compared to the Depth of the Viterbi decoder), at the cost
+     * of weaker error correction. The input is the same as for ConvolutionalDecoder.
+     *
+     * Template parameters:
+     * - ConstraintLength: the constraint length of the code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - Polynomials: the polynomials used for this convolutional code
+     */
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    class ThresholdConvolutionalDecoder final {
+        
+        // Check template parameters using static asserts
+        static_assert((sizeof(TShiftReg) * 8) >= ConstraintLength, "The shift register must be able to hold the constraint length of the code.");
+        static_assert(ConstraintLength >= 2, "The ConstraintLength template parameter must be at least two.");
+        static_assert(sizeof...(Polynomials) >= 2, "There must be a systematic polynomial and at least one parity polynomial.");
+        static_assert(sizeof(TShiftReg) <= sizeof(unsigned), "The shift register must fit into an unsigned int.");
+        
+    private:
+        
+        // Number of outputs of the convolutional code (each polynomial corresponds to an output)
+        constexpr static uint32_t outputCount_ = sizeof...(Polynomials);
+        
+        // Unpack variadic template argument, to allow access to each polynomial
+        constexpr static TShiftReg polynomials_[sizeof...(Polynomials)] = { Polynomials... };
+        
+        // The systematic polynomial
+        constexpr static TShiftReg systematicPolynomial_ = static_cast<TShiftReg>(1) << (ConstraintLength - 1);
+        
+        // Mask of the bits used in the shift registers
+        constexpr static TShiftReg shiftRegMask_ = static_cast<TShiftReg>(systematicPolynomial_ | (systematicPolynomial_ - 1));
+        
+        // Bit position of the systematic output within a received symbol
+        uint32_t systematicBitPos_;
+        
+        // Number of parity checks that contain each decoded bit
+        uint32_t checkCount_;
+        
+        // Received information bits, the newest one is the MSB
+        TShiftReg shiftReg_;
+        
+        // Syndrome registers of each output (only used for the parity outputs), the newest bit is the LSB
+        TShiftReg syndromes_[sizeof...(Polynomials)];
+        
+        // Received bits of an incomplete symbol
+        TShiftReg pendingBits_;
+        
+        // Number of received bits of the incomplete symbol
+        uint32_t pendingCount_;
+        
+        // Number of steps taken since the last reset
+        size_t stepCount_;
+        
+        // Output
+        uint8_t *output_;
+        
+        // Current output address
+        size_t outAddr_;
+        
+        // Current output bit position
+        uint32_t outBitPos_;
+        
+        inline void putOutputBit(uint8_t bit) {
+            if (outBitPos_ == 7) {
+                output_[outAddr_] = 0;
+            }
+            
+            output_[outAddr_] |= static_cast<uint8_t>(bit << outBitPos_);
+            
+            if (outBitPos_ == 0) {
+                outBitPos_ = 7;
+                outAddr_++;
+            }
+            else {
+                outBitPos_--;
+            }
+        }
+        
+        // Decides about the oldest received information bit, corrects the syndromes and outputs the bit.
+        // The bit is flipped when more than half of the given number of checks fail.
+        inline void decideOldestBit(uint32_t checks) {
+            uint32_t failedChecks = 0;
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                if (o != systematicBitPos_) {
+                    failedChecks += ::fecmagic::computePopcount(syndromes_[o] & polynomials_[o]);
+                }
+            }
+            
+            uint8_t bit = shiftReg_ & 1;
+            if (2 * failedChecks > checks) {
+                bit ^= 1;
+                for (uint32_t o = 0; o < outputCount_; o++) {
+                    if (o != systematicBitPos_) {
+                        syndromes_[o] ^= polynomials_[o];
+                    }
+                }
+            }
+            
+            putOutputBit(bit);
+        }
+        
+        // Processes a received symbol.
+        inline void decodeStep(TShiftReg symbol) {
+            shiftReg_ = static_cast<TShiftReg>((shiftReg_ >> 1) | (((symbol >> (outputCount_ - 1 - systematicBitPos_)) & 1) << (ConstraintLength - 1)));
+            
+            TShiftReg anySyndrome = 0;
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                uint8_t received = (symbol >> (outputCount_ - 1 - o)) & 1;
+                uint8_t syndrome = received ^ ::fecmagic::computeParity(shiftReg_ & polynomials_[o]);
+                syndromes_[o] = static_cast<TShiftReg>(((syndromes_[o] << 1) | syndrome) & shiftRegMask_);
+                anySyndrome |= syndromes_[o];
+            }
+            
+            // The first ConstraintLength - 1 steps don't have a bit that could be decoded
+            if (stepCount_ >= ConstraintLength - 1) {
+                if (anySyndrome == 0) {
+                    // No failed checks, which is the most common case
+                    putOutputBit(shiftReg_ & 1);
+                }
+                else {
+                    decideOldestBit(checkCount_);
+                }
+            }
+            
+            stepCount_++;
+        }
+        
+    public:
+        
+        /**
+         * @brief Tells whether the code is self-orthogonal.
+         *
+         * This is the case when every difference between two tap positions of the parity
+         * polynomials occurs only once. The decoder only works well with such codes.
+         */
+        static bool isSelfOrthogonal() {
+            uint32_t differences[ConstraintLength] = { 0 };
+            
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                if (polynomials_[o] == systematicPolynomial_) {
+                    continue;
+                }
+                for (uint32_t i = 0; i < ConstraintLength; i++) {
+                    for (uint32_t j = i + 1; j < ConstraintLength; j++) {
+                        if (((polynomials_[o] >> i) & 1) && ((polynomials_[o] >> j) & 1)) {
+                            if (++differences[j - i] > 1) {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+            
+            return true;
+        }
+        
+        /**
+         * @brief Returns the number of steps after which a bit is decoded.
+         */
+        constexpr static uint32_t decodingDelay() {
+            return ConstraintLength - 1;
+        }
+        
+        /**
+         * @brief Creates a threshold decoder and sets the given output.
+         */
+        explicit ThresholdConvolutionalDecoder(void *output = nullptr)
+            : systematicBitPos_(outputCount_), checkCount_(0) {
+            
+            // Find the systematic polynomial, the rest of them are parity polynomials
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                if (polynomials_[o] == systematicPolynomial_ && systematicBitPos_ == outputCount_) {
+                    systematicBitPos_ = o;
+                }
+                else {
+                    checkCount_ += ::fecmagic::computePopcount(polynomials_[o]);
+                }
+            }
+            assert(systematicBitPos_ < outputCount_);
+            assert(isSelfOrthogonal());
+            
+            reset(output);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        ThresholdConvolutionalDecoder(const ThresholdConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        ThresholdConvolutionalDecoder &operator=(const ThresholdConvolutionalDecoder &other) = delete;
+        
+        /**
+         * @brief Returns the number of parity checks that contain each decoded bit (J).
+         */
+        inline uint32_t checkCount() const {
+            return checkCount_;
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         *
+         * Like ConvolutionalDecoder, the decoded bits of the flushed encoder are also output.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            size_t outputBits = (inputSize * 8 + outputCount_ - 1) / outputCount_;
+            return (outputBits + 7) / 8;
+        }
+        
+        /**
+         * @brief Resets the decoder and sets the given output.
+         */
+        void reset(void *output) {
+            output_ = reinterpret_cast<uint8_t*>(output);
+            outAddr_ = 0;
+            outBitPos_ = 7;
+            
+            // The encoder always starts at the 0 state
+            shiftReg_ = 0;
+            for (uint32_t o = 0; o < outputCount_; o++) {
+                syndromes_[o] = 0;
+            }
+            
+            pendingBits_ = 0;
+            pendingCount_ = 0;
+            stepCount_ = 0;
+        }
+        
+        /**
+         * @brief Decodes a given block.
+         *
+         * Each bit is output ConstraintLength - 1 steps after it was received.
+         * An incomplete symbol at the end of the input is kept until the next call.
+         * The caller is responsible for making sure that enough memory is allocated
+         * to fit the output.
+         *
+         * This method is suitable for streaming.
+         */
+        void decode(const void *input, size_t inputSize) {
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            assert(inputBytes != nullptr || inputSize == 0);
+            assert(output_ != nullptr);
+            
+            for (size_t i = 0; i < inputSize; i++) {
+                for (int32_t b = 7; b >= 0; b--) {
+                    pendingBits_ = static_cast<TShiftReg>((pendingBits_ << 1) | ((inputBytes[i] >> b) & 1));
+                    if (++pendingCount_ == outputCount_) {
+                        decodeStep(pendingBits_);
+                        pendingBits_ = 0;
+                        pendingCount_ = 0;
+                    }
+                }
+            }
+        }
+        
+        /**
+         * @brief Outputs the remaining bits at the end of the stream.
+         *
+         * The last bits are decided with the parity checks that were received,
+         * these are the flushed bits of the encoder.
+         */
+        void flush() {
+            // Complete an incomplete symbol with zeroes
+            if (pendingCount_ > 0) {
+                decodeStep(static_cast<TShiftReg>(pendingBits_ << (outputCount_ - pendingCount_)));
+                pendingBits_ = 0;
+                pendingCount_ = 0;
+            }
+            
+            // Shift out the bits that are still in the register, without new checks
+            TShiftReg valid = shiftRegMask_;
+            for (uint32_t i = 0; i < ConstraintLength - 1; i++) {
+                shiftReg_ >>= 1;
+                valid = static_cast<TShiftReg>((valid << 1) & shiftRegMask_);
+                for (uint32_t o = 0; o < outputCount_; o++) {
+                    syndromes_[o] = static_cast<TShiftReg>((syndromes_[o] << 1) & shiftRegMask_);
+                }
+                
+                if (stepCount_ + i >= ConstraintLength - 1) {
+                    uint32_t checks = 0;
+                    for (uint32_t o = 0; o < outputCount_; o++) {
+                        if (o != systematicBitPos_) {
+                            checks += ::fecmagic::computePopcount(valid & polynomials_[o]);
+                        }
+                    }
+                    decideOldestBit(checks);
+                }
+            }
+            
+            stepCount_ = 0;
+        }
+        
+    };
+    
+    // Definition for the static member ThresholdConvolutionalDecoder::polynomials_
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg ...Polynomials>
+    constexpr TShiftReg ThresholdConvolutionalDecoder<ConstraintLength, TShiftReg, Polynomials...>::polynomials_[sizeof...(Polynomials)];
+
+}
+
+#endif // FECMAGIC_THRESHOLD_DECODER_H
@@ -0,0 +1,572 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_TURBO_DECODER_H
+#define FECMAGIC_TURBO_DECODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "fecmagic-global.h"
+#include "interleaver.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Decoder for the parallel concatenated (turbo) code of TurboEncoder.
+     *
+     * The decoder runs two constituent max-log-MAP decoders that exchange scaled
+     * extrinsic information. The forward and backward recursions are computed in
+     * windows of WindowLength steps: the backward recursion of each window is
+     * started WindowLength steps further, so only one window of forward metrics
+     * needs to be stored at a time. For codes with 8 states (such as the LTE turbo code),
+     * the recursions are vectorized over the states using SSE2 instructions where they
+     * are available, otherwise a generic implementation is used.
+     *
+     * The input are the soft values (LLRs) of the bits produced by TurboEncoder,
+     * in the same order. A positive value means the bit is more likely to be 0,
+     * and a negative value means it is more likely to be 1; 0 means nothing is
+     * known about the bit.
+     *
+     * Decoding can stop early when the hard decisions of the two constituent
+     * decoders agree, or when a CRC (or other) check of the decoded block passes.
+     *
+     * Template parameters:
+     * - WindowLength: number of steps in a window of the recursions
+     * - ConstraintLength: the constraint length of the constituent code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - FeedbackPolynomial: feedback polynomial of the constituent code
+     * - FeedforwardPolynomial: feed-forward polynomial of the constituent code
+     */
+    template<uint32_t WindowLength, uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg FeedforwardPolynomial>
+    class TurboDecoder final {
+        // Check template parameters using static asserts
+        static_assert((sizeof(TShiftReg) * 8) >= ConstraintLength, "The shift register must be able to hold the constraint length of the code.");
+        static_assert(ConstraintLength >= 2, "The ConstraintLength template parameter must be at least two.");
+        static_assert(ConstraintLength <= 12, "The ConstraintLength template parameter is too large for this decoder.");
+        static_assert(WindowLength >= 2, "The WindowLength template parameter must be at least two.");
+        static_assert(((FeedbackPolynomial >> (ConstraintLength - 1)) & 1) == 1, "The feedback polynomial must contain the bit that is being shifted in.");
+        
+    public:
+        
+        // Number of termination bits at the end of each block
+        constexpr static uint32_t tailBitCount = 4 * (ConstraintLength - 1);
+        
+        // Function that checks a decoded block, for example by its CRC
+        typedef ::std::function<bool(const uint8_t *decoded, size_t size)> BlockCheck;
+        
+    private:
+        
+        // Number of possible encoder states
+        constexpr static uint32_t stateCount = (1 << (ConstraintLength - 1));
+        
+        // Number of termination steps
+        constexpr static uint32_t tailSteps = ConstraintLength - 1;
+        
+        // A priori values are limited to this, so that the metrics fit into 16 bits
+        constexpr static int32_t maxApriori = 2047;
+        
+        // Metric of a state that can't be reached, used by the generic implementation
+        constexpr static int32_t unreachableMetric = ::std::numeric_limits<int32_t>::min() / 4;
+        
+        // Describes the branches of the trellis
+        struct Trellis final {
+            // Next state for each state and shifted bit
+            uint32_t next[stateCount][2];
+            // Input bit for each state and shifted bit
+            uint8_t input[stateCount][2];
+            // Parity bit for each state and shifted bit
+            uint8_t parity[stateCount][2];
+            
+            explicit Trellis() {
+                for (uint32_t s = 0; s < stateCount; s++) {
+                    for (uint32_t a = 0; a < 2; a++) {
+                        TShiftReg shiftReg = static_cast<TShiftReg>(s | (a << (ConstraintLength - 1)));
+                        next[s][a] = shiftReg >> 1;
+                        input[s][a] = a ^ ::fecmagic::computeParity(FeedbackPolynomial & s);
+                        parity[s][a] = ::fecmagic::computeParity(FeedforwardPolynomial & shiftReg);
+                    }
+                }
+            }
+        };
+        
+        // Returns the trellis, which is created when it is first needed
+        static inline const Trellis &trellis() {
+            static const Trellis t;
+            return t;
+        }
+        
+        // Branch metric: the a priori and systematic value counts when the input bit is 0,
+        // and the parity value counts when the parity bit is 0.
+        static inline int32_t branchMetric(uint8_t input, uint8_t parity, int32_t lsa, int32_t lp) {
+            return (input ? 0 : lsa) + (parity ? 0 : lp);
+        }
+        
+        // Generic max-log-MAP decoder for a constituent code.
+        // Computes the LLR of the input bits of the first outputSteps steps,
+        // using windowed recursions. The trellis is terminated after totalSteps.
+        void mapGeneric(const int16_t *lsa, const int16_t *lp, size_t totalSteps, size_t outputSteps, int16_t *llr) {
+            const Trellis &t = trellis();
+            int32_t *alphaWindow = alphaWindowGeneric_.data();
+            int32_t alpha[stateCount], beta[stateCount], tmp[stateCount];
+            
+            // The encoder starts at the zero state
+            for (uint32_t s = 0; s < stateCount; s++) {
+                alpha[s] = (s == 0) ? 0 : unreachableMetric;
+            }
+            
+            for (size_t w0 = 0; w0 < outputSteps; w0 += WindowLength) {
+                size_t w1 = ::std::min(w0 + WindowLength, totalSteps);
+                
+                // Forward recursion through the window
+                for (size_t k = w0; k < w1; k++) {
+                    memcpy(alphaWindow + (k - w0) * stateCount, alpha, sizeof(alpha));
+                    for (uint32_t s = 0; s < stateCount; s++) {
+                        tmp[s] = unreachableMetric;
+                    }
+                    for (uint32_t s = 0; s < stateCount; s++) {
+                        for (uint32_t a = 0; a < 2; a++) {
+                            int32_t m = alpha[s] + branchMetric(t.input[s][a], t.parity[s][a], lsa[k], lp[k]);
+                            tmp[t.next[s][a]] = ::std::max(tmp[t.next[s][a]], m);
+                        }
+                    }
+                    for (uint32_t s = 0; s < stateCount; s++) {
+                        alpha[s] = ::std::max(tmp[s] - tmp[0], unreachableMetric);
+                    }
+                }
+                
+                // Initialize the backward recursion: at the end of the block the
+                // encoder is in the zero state, otherwise train from further away
+                size_t trainingEnd = ::std::min(w1 + WindowLength, totalSteps);
+                for (uint32_t s = 0; s < stateCount; s++) {
+                    beta[s] = (trainingEnd == totalSteps && s != 0) ? unreachableMetric : 0;
+                }
+                
+                for (size_t k = trainingEnd; k-- > w0; ) {
+                    // Compute the LLR of the steps inside the window
+                    if (k < w1 && k < outputSteps) {
+                        const int32_t *alphaK = alphaWindow + (k - w0) * stateCount;
+                        int32_t max0 = unreachableMetric * 2;
+                        int32_t max1 = unreachableMetric * 2;
+                        for (uint32_t s = 0; s < stateCount; s++) {
+                            for (uint32_t a = 0; a < 2; a++) {
+                                int32_t m = alphaK[s] + branchMetric(t.input[s][a], t.parity[s][a], lsa[k], lp[k]) + beta[t.next[s][a]];
+                                if (t.input[s][a]) {
+                                    max1 = ::std::max(max1, m);
+                                }
+                                else {
+                                    max0 = ::std::max(max0, m);
+                                }
+                            }
+                        }
+                        llr[k] = static_cast<int16_t>(::std::max(::std::min(max0 - max1, 32767), -32767));
+                    }
+                    
+                    // Backward recursion
+                    for (uint32_t s = 0; s < stateCount; s++) {
+                        tmp[s] = ::std::max(
+                            beta[t.next[s][0]] + branchMetric(t.input[s][0], t.parity[s][0], lsa[k], lp[k]),
+                            beta[t.next[s][1]] + branchMetric(t.input[s][1], t.parity[s][1], lsa[k], lp[k]));
+                    }
+                    for (uint32_t s = 0; s < stateCount; s++) {
+                        beta[s] = ::std::max(tmp[s] - tmp[0], unreachableMetric);
+                    }
+                }
+            }
+        }
+        
+#ifdef COMPILE_SSE2_CODE
+        // Selects lanes of a where the mask is set, and lanes of b elsewhere
+        static inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+            return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+        }
+        
+        // Returns the maximum of the eight 16-bit lanes
+        static inline int16_t horizontalMax(__m128i v) {
+            v = _mm_max_epi16(v, _mm_shuffle_epi32(v, 0x4e));
+            v = _mm_max_epi16(v, _mm_shuffle_epi32(v, 0xb1));
+            v = _mm_max_epi16(v, _mm_shufflelo_epi16(v, 0xb1));
+            return static_cast<int16_t>(_mm_cvtsi128_si32(v));
+        }
+        
+        // Subtracts the metric of state 0 from every state
+        static inline __m128i normalize(__m128i v) {
+            __m128i v0 = _mm_shufflelo_epi16(v, 0);
+            return _mm_subs_epi16(v, _mm_unpacklo_epi64(v0, v0));
+        }
+        
+        // Creates a lane mask from 8 bits, where each lane is set if the bit is 0
+        static inline __m128i zeroMask(const uint8_t *bits) {
+            return _mm_set_epi16(
+                bits[7] ? 0 : -1, bits[6] ? 0 : -1, bits[5] ? 0 : -1, bits[4] ? 0 : -1,
+                bits[3] ? 0 : -1, bits[2] ? 0 : -1, bits[1] ? 0 : -1, bits[0] ? 0 : -1);
+        }
+        
+        // Max-log-MAP decoder for a constituent code with 8 states,
+        // vectorized over the states using SSE2 (each state is a 16-bit lane).
+        void mapSse2(const int16_t *lsa, const int16_t *lp, size_t totalSteps, size_t outputSteps, int16_t *llr) {
+            const Trellis &t = trellis();
+            int16_t *alphaWindow = alphaWindowSse2_.data();
+            
+            // Lane masks for the forward recursion, where lane i is the next state and
+            // x selects the previous state: ((i << 1) & 7) | x with shifted bit (i >> 2)
+            uint8_t bits[8];
+            __m128i fwdInput0[2], fwdParity0[2];
+            for (uint32_t x = 0; x < 2; x++) {
+                for (uint32_t i = 0; i < 8; i++) {
+                    bits[i] = t.input[((i << 1) & 7) | x][i >> 2];
+                }
+                fwdInput0[x] = zeroMask(bits);
+                for (uint32_t i = 0; i < 8; i++) {
+                    bits[i] = t.parity[((i << 1) & 7) | x][i >> 2];
+                }
+                fwdParity0[x] = zeroMask(bits);
+            }
+            
+            // Lane masks for the backward recursion, where lane i is the
+            // current state and a is the shifted bit
+            __m128i bwdInput0[2], bwdParity0[2];
+            for (uint32_t a = 0; a < 2; a++) {
+                for (uint32_t i = 0; i < 8; i++) {
+                    bits[i] = t.input[i][a];
+                }
+                bwdInput0[a] = zeroMask(bits);
+                for (uint32_t i = 0; i < 8; i++) {
+                    bits[i] = t.parity[i][a];
+                }
+                bwdParity0[a] = zeroMask(bits);
+            }
+            
+            const __m128i unreachable = _mm_set1_epi16(-16384);
+            const __m128i zeroStateOnly = _mm_set_epi16(-16384, -16384, -16384, -16384, -16384, -16384, -16384, 0);
+            
+            // The encoder starts at the zero state
+            __m128i alpha = zeroStateOnly;
+            __m128i beta;
+            
+            for (size_t w0 = 0; w0 < outputSteps; w0 += WindowLength) {
+                size_t w1 = ::std::min(w0 + WindowLength, totalSteps);
+                
+                // Forward recursion through the window
+                for (size_t k = w0; k < w1; k++) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(alphaWindow + (k - w0) * 8), alpha);
+                    
+                    __m128i vlsa = _mm_set1_epi16(lsa[k]);
+                    __m128i vlp = _mm_set1_epi16(lp[k]);
+                    
+                    // Previous states of each state: even ones for x=0, odd ones for x=1
+                    __m128i even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(alpha, 16), 16), _mm_srai_epi32(_mm_slli_epi32(alpha, 16), 16));
+                    __m128i odd = _mm_packs_epi32(_mm_srai_epi32(alpha, 16), _mm_srai_epi32(alpha, 16));
+                    
+                    __m128i m0 = _mm_adds_epi16(even, _mm_adds_epi16(_mm_and_si128(fwdInput0[0], vlsa), _mm_and_si128(fwdParity0[0], vlp)));
+                    __m128i m1 = _mm_adds_epi16(odd, _mm_adds_epi16(_mm_and_si128(fwdInput0[1], vlsa), _mm_and_si128(fwdParity0[1], vlp)));
+                    alpha = _mm_max_epi16(normalize(_mm_max_epi16(m0, m1)), unreachable);
+                }
+                
+                // Initialize the backward recursion: at the end of the block the
+                // encoder is in the zero state, otherwise train from further away
+                size_t trainingEnd = ::std::min(w1 + WindowLength, totalSteps);
+                beta = (trainingEnd == totalSteps) ? zeroStateOnly : _mm_setzero_si128();
+                
+                for (size_t k = trainingEnd; k-- > w0; ) {
+                    __m128i vlsa = _mm_set1_epi16(lsa[k]);
+                    __m128i vlp = _mm_set1_epi16(lp[k]);
+                    
+                    // Metrics of the next states: (i >> 1) for a=0 and (i >> 1) | 4 for a=1
+                    __m128i g0 = _mm_adds_epi16(_mm_and_si128(bwdInput0[0], vlsa), _mm_and_si128(bwdParity0[0], vlp));
+                    __m128i g1 = _mm_adds_epi16(_mm_and_si128(bwdInput0[1], vlsa), _mm_and_si128(bwdParity0[1], vlp));
+                    __m128i m0 = _mm_adds_epi16(_mm_unpacklo_epi16(beta, beta), g0);
+                    __m128i m1 = _mm_adds_epi16(_mm_unpackhi_epi16(beta, beta), g1);
+                    
+                    // Compute the LLR of the steps inside the window
+                    if (k < w1 && k < outputSteps) {
+                        __m128i alphaK = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alphaWindow + (k - w0) * 8));
+                        __m128i p0 = _mm_adds_epi16(alphaK, m0);
+                        __m128i p1 = _mm_adds_epi16(alphaK, m1);
+                        
+                        // For a=0, the input bit is 0 where the input mask is set
+                        __m128i max0 = select(bwdInput0[0], p0, p1);
+                        __m128i max1 = select(bwdInput0[0], p1, p0);
+                        int32_t l = static_cast<int32_t>(horizontalMax(max0)) - horizontalMax(max1);
+                        llr[k] = static_cast<int16_t>(::std::max(::std::min(l, 32767), -32767));
+                    }
+                    
+                    // Backward recursion
+                    beta = _mm_max_epi16(normalize(_mm_max_epi16(m0, m1)), unreachable);
+                }
+            }
+        }
+#endif
+        
+        // Runs one of the constituent decoders
+        inline void map(const int16_t *lsa, const int16_t *lp, size_t totalSteps, size_t outputSteps, int16_t *llr) {
+#ifdef COMPILE_SSE2_CODE
+            if (stateCount == 8 && SSE2_SUPPORTED) {
+                mapSse2(lsa, lp, totalSteps, outputSteps, llr);
+                return;
+            }
+#endif
+            mapGeneric(lsa, lp, totalSteps, outputSteps, llr);
+        }
+        
+        // Computes the scaled and limited a priori value from the extrinsic value
+        inline int16_t scaleExtrinsic(int32_t extrinsic) const {
+            int32_t scaled = (extrinsic * extrinsicScale_) / 256;
+            return static_cast<int16_t>(::std::max(::std::min(scaled, maxApriori), -maxApriori));
+        }
+        
+        // The interleaver
+        const Interleaver &interleaver_;
+        
+        // Number of bits in a block
+        size_t n_;
+        
+        // Maximum number of iterations
+        uint32_t maxIterations_;
+        
+        // Scale of the extrinsic values, in 1/256 units
+        int32_t extrinsicScale_ = 192;
+        
+        // Whether to stop when the hard decisions of the two decoders agree
+        bool stopOnAgreement_ = true;
+        
+        // Check that stops decoding when it passes
+        BlockCheck blockCheck_;
+        
+        // Systematic values (in natural and interleaved order)
+        std::vector<int16_t> ls_, lsInterleaved_;
+        // Input of the constituent decoders (including termination)
+        std::vector<int16_t> lsa1_, lp1_, lsa2_, lp2_;
+        // A priori values of the constituent decoders
+        std::vector<int16_t> la1_, la2_;
+        // Output of the constituent decoders
+        std::vector<int16_t> llr1_, llr2_;
+        // Temporary buffers
+        std::vector<int16_t> tmp_, llr_;
+        std::vector<uint8_t> decisions_;
+        // Forward metrics of a window
+        std::vector<int32_t> alphaWindowGeneric_;
+        std::vector<int16_t> alphaWindowSse2_;
+        
+        // Makes hard decisions from the given LLRs
+        void decide(const int16_t *llr, uint8_t *output) const {
+            for (size_t i = 0; i < n_ / 8; i++) {
+                uint8_t b = 0;
+                for (uint32_t j = 0; j < 8; j++) {
+                    b = (b << 1) | (llr[i * 8 + j] < 0 ? 1 : 0);
+                }
+                output[i] = b;
+            }
+        }
+        
+    public:
+        
+        /**
+         * @brief Creates a turbo decoder that uses the given interleaver.
+         *
+         * The interleaver must be the same as the one used by the encoder,
+         * and it must outlive the decoder.
+         */
+        explicit TurboDecoder(const Interleaver &interleaver, uint32_t maxIterations = 8)
+            : interleaver_(interleaver), n_(interleaver.size()), maxIterations_(maxIterations),
+              ls_(n_), lsInterleaved_(n_),
+              lsa1_(n_ + tailSteps), lp1_(n_ + tailSteps), lsa2_(n_ + tailSteps), lp2_(n_ + tailSteps),
+              la1_(n_), la2_(n_), llr1_(n_), llr2_(n_), tmp_(n_), llr_(n_), decisions_(n_ / 8),
+              alphaWindowGeneric_(WindowLength * stateCount), alphaWindowSse2_(WindowLength * 8) {
+            assert(n_ % 8 == 0);
+            assert(maxIterations >= 1);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        TurboDecoder(const TurboDecoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        TurboDecoder &operator=(const TurboDecoder &other) = delete;
+        
+        /**
+         * @brief Returns the size of a decoded block in bytes.
+         */
+        inline size_t blockSize() const {
+            return n_ / 8;
+        }
+        
+        /**
+         * @brief Returns the number of soft values in an encoded block.
+         */
+        inline size_t inputSize() const {
+            return n_ * 3 + tailBitCount;
+        }
+        
+        /**
+         * @brief Sets the maximum number of iterations.
+         */
+        inline void setMaxIterations(uint32_t maxIterations) {
+            assert(maxIterations >= 1);
+            maxIterations_ = maxIterations;
+        }
+        
+        /**
+         * @brief Sets the scale of the extrinsic information that the two decoders exchange.
+         *
+         * Scaling compensates for the max-log approximation being overly optimistic,
+         * a value of about 0.7 usually works well. The default is 0.75.
+         */
+        inline void setExtrinsicScale(float scale) {
+            assert(scale > 0.0f && scale <= 1.0f);
+            extrinsicScale_ = static_cast<int32_t>(scale * 256.0f + 0.5f);
+        }
+        
+        /**
+         * @brief Sets whether to stop when the hard decisions of the two constituent decoders agree.
+         *
+         * This is enabled by default.
+         */
+        inline void setStopOnAgreement(bool enabled) {
+            stopOnAgreement_ = enabled;
+        }
+        
+        /**
+         * @brief Sets a check, such as a CRC, that stops decoding when it passes.
+         *
+         * The check is called with the decoded block after every iteration.
+         * Pass an empty function to disable it.
+         */
+        inline void setBlockCheck(BlockCheck check) {
+            blockCheck_ = ::std::move(check);
+        }
+        
+        /**
+         * @brief Returns the LLRs of the decoded bits of the last decoded block.
+         */
+        inline const int16_t *llr() const {
+            return llr_.data();
+        }
+        
+        /**
+         * @brief Decodes one block.
+         *
+         * The input must contain inputSize() soft values, and the output
+         * must have space for blockSize() bytes.
+         *
+         * Returns the number of iterations that were done.
+         */
+        uint32_t decode(const int8_t *input, void *output) {
+            assert(input != nullptr);
+            assert(output != nullptr);
+            uint8_t *outputBytes = reinterpret_cast<uint8_t*>(output);
+            
+            // Separate the input into the systematic and parity values
+            for (size_t i = 0; i < n_; i++) {
+                ls_[i] = input[3 * i];
+                lp1_[i] = input[3 * i + 1];
+                lp2_[i] = input[3 * i + 2];
+            }
+            interleaver_.interleave(ls_.data(), lsInterleaved_.data());
+            
+            // Termination of the two decoders
+            const int8_t *tail = input + 3 * n_;
+            for (uint32_t i = 0; i < tailSteps; i++) {
+                lsa1_[n_ + i] = tail[2 * i];
+                lp1_[n_ + i] = tail[2 * i + 1];
+                lsa2_[n_ + i] = tail[2 * tailSteps + 2 * i];
+                lp2_[n_ + i] = tail[2 * tailSteps + 2 * i + 1];
+            }
+            
+            // Nothing is known a priori
+            ::std::fill(la1_.begin(), la1_.end(), 0);
+            
+            uint32_t iteration = 0;
+            while (iteration < maxIterations_) {
+                iteration++;
+                
+                // First decoder
+                for (size_t i = 0; i < n_; i++) {
+                    lsa1_[i] = ls_[i] + la1_[i];
+                }
+                map(lsa1_.data(), lp1_.data(), n_ + tailSteps, n_, llr1_.data());
+                
+                // Extrinsic information of the first decoder is a priori information for the second
+                for (size_t i = 0; i < n_; i++) {
+                    tmp_[i] = scaleExtrinsic(static_cast<int32_t>(llr1_[i]) - lsa1_[i]);
+                }
+                interleaver_.interleave(tmp_.data(), la2_.data());
+                
+                // Second decoder
+                for (size_t i = 0; i < n_; i++) {
+                    lsa2_[i] = lsInterleaved_[i] + la2_[i];
+                }
+                map(lsa2_.data(), lp2_.data(), n_ + tailSteps, n_, llr2_.data());
+                
+                // Extrinsic information of the second decoder is a priori information for the first
+                for (size_t i = 0; i < n_; i++) {
+                    tmp_[i] = scaleExtrinsic(static_cast<int32_t>(llr2_[i]) - lsa2_[i]);
+                }
+                interleaver_.deinterleave(tmp_.data(), la1_.data());
+                
+                // Decisions are made from the output of the second decoder
+                interleaver_.deinterleave(llr2_.data(), llr_.data());
+                decide(llr_.data(), outputBytes);
+                
+                // Check whether we can stop early
+                if (blockCheck_ && blockCheck_(outputBytes, n_ / 8)) {
+                    break;
+                }
+                if (stopOnAgreement_) {
+                    decide(llr1_.data(), decisions_.data());
+                    if (0 == memcmp(decisions_.data(), outputBytes, n_ / 8)) {
+                        break;
+                    }
+                }
+            }
+            
+            return iteration;
+        }
+        
+    };
+    
+    // Definitions for the static members TurboDecoder::maxApriori and TurboDecoder::unreachableMetric
+    template<uint32_t WindowLength, uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg FeedforwardPolynomial>
+    constexpr int32_t TurboDecoder<WindowLength, ConstraintLength, TShiftReg, FeedbackPolynomial, FeedforwardPolynomial>::maxApriori;
+    
+    template<uint32_t WindowLength, uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg FeedforwardPolynomial>
+    constexpr int32_t TurboDecoder<WindowLength, ConstraintLength, TShiftReg, FeedbackPolynomial, FeedforwardPolynomial>::unreachableMetric;
+    
+    /**
+     * @brief Decoder for the turbo code used by LTE and UMTS, with 8-state constituent codes.
+     */
+    template<uint32_t WindowLength = 32>
+    using LteTurboDecoder = TurboDecoder<WindowLength, 4, uint8_t, 0xb, 0xd>;
+
+}
+
+#endif // FECMAGIC_TURBO_DECODER_H
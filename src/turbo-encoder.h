@@ -0,0 +1,203 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef FECMAGIC_TURBO_ENCODER_H
+#define FECMAGIC_TURBO_ENCODER_H
+
+#include <cstdint>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "fecmagic-global.h"
+#include "interleaver.h"
+#include "recursive-convolutional-encoder.h"
+
+namespace fecmagic {
+
+    /**
+     * @brief Encoder that produces parallel concatenated (turbo) code.
+     *
+     * The turbo encoder consists of two identical RSC encoders: the first one encodes
+     * the input, and the second one encodes the interleaved input. Both encoders are
+     * terminated at the end of every block. The code rate is 1/3.
+     *
+     * Output layout (MSB first), for a block of N input bits:
+     * - N triplets of the systematic bit, the parity bit of the first encoder
+     *   and the parity bit of the second encoder
+     * - (ConstraintLength - 1) pairs of the systematic and parity termination
+     *   bits of the first encoder
+     * - (ConstraintLength - 1) pairs of the systematic and parity termination
+     *   bits of the second encoder
+     *
+     * The block size is determined by the interleaver, and it must be a multiple of 8.
+     *
+     * Template parameters:
+     * - ConstraintLength: the constraint length of the constituent code
+     * - TShiftReg: unsigned integral type that can hold the shift register
+     * - FeedbackPolynomial: feedback polynomial of the constituent code
+     * - FeedforwardPolynomial: feed-forward polynomial of the constituent code
+     */
+    template<uint32_t ConstraintLength, typename TShiftReg, TShiftReg FeedbackPolynomial, TShiftReg FeedforwardPolynomial>
+    class TurboEncoder final {
+    
+    public:
+        
+        // The constituent encoder
+        typedef RecursiveSystematicConvolutionalEncoder<ConstraintLength, TShiftReg, FeedbackPolynomial, FeedforwardPolynomial> ConstituentEncoder;
+        
+        // Number of termination bits at the end of each block
+        constexpr static uint32_t tailBitCount = 4 * (ConstraintLength - 1);
+        
+    private:
+        
+        // Spreads the bits of a byte so that there are two zeroes between them
+        struct Tables final {
+            uint32_t spread[256];
+            
+            explicit Tables() {
+                for (uint32_t b = 0; b < 256; b++) {
+                    spread[b] = 0;
+                    for (uint32_t i = 0; i < 8; i++) {
+                        spread[b] |= ((b >> (7 - i)) & 1) << (23 - 3 * i);
+                    }
+                }
+            }
+        };
+        
+        // Returns the tables, which are created when they are first needed
+        static inline const Tables &tables() {
+            static const Tables t;
+            return t;
+        }
+        
+        // The interleaver
+        const Interleaver &interleaver_;
+        
+        // Buffer for the interleaved input
+        std::vector<uint8_t> interleavedInput_;
+        
+        // Scratch buffer used while interleaving
+        std::vector<uint8_t> scratch_;
+        
+    public:
+        
+        /**
+         * @brief Creates a turbo encoder that uses the given interleaver.
+         *
+         * The interleaver must outlive the encoder.
+         */
+        explicit TurboEncoder(const Interleaver &interleaver)
+            : interleaver_(interleaver), interleavedInput_(interleaver.size() / 8), scratch_(interleaver.size()) {
+            assert(interleaver.size() % 8 == 0);
+        }
+        
+        /**
+         * @brief Copy constructor. Intentionally disabled for this class.
+         */
+        TurboEncoder(const TurboEncoder &other) = delete;
+        
+        /**
+         * @brief Copy assignment operator. Intentionally disabled for this class.
+         */
+        TurboEncoder &operator=(const TurboEncoder &other) = delete;
+        
+        /**
+         * @brief Returns the size of an input block in bytes.
+         */
+        inline size_t blockSize() const {
+            return interleaver_.size() / 8;
+        }
+        
+        /**
+         * @brief Returns the size of the output you need to allocate for a given input.
+         */
+        static inline size_t calculateOutputSize(size_t inputSize) {
+            size_t outputBits = inputSize * 8 * 3 + tailBitCount;
+            return (outputBits / 8) + ((outputBits % 8) ? 1 : 0);
+        }
+        
+        /**
+         * @brief Encodes one block.
+         *
+         * The input must be blockSize() bytes, and the output must have space for
+         * calculateOutputSize(blockSize()) bytes.
+         */
+        void encode(const void *input, void *output) {
+            const uint8_t *inputBytes = reinterpret_cast<const uint8_t*>(input);
+            uint8_t *outputBytes = reinterpret_cast<uint8_t*>(output);
+            assert(inputBytes != nullptr);
+            assert(outputBytes != nullptr);
+            
+            const size_t n = blockSize();
+            const Tables &t = tables();
+            
+            // Interleave input for the second encoder
+            interleaver_.interleaveBits(inputBytes, interleavedInput_.data(), scratch_.data());
+            
+            // Encode both, a byte at a time
+            TShiftReg state1 = 0;
+            TShiftReg state2 = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint8_t sys = inputBytes[i];
+                uint8_t par1, par2;
+                ConstituentEncoder::encodeByte(state1, sys, &par1);
+                ConstituentEncoder::encodeByte(state2, interleavedInput_[i], &par2);
+                
+                uint32_t bits = t.spread[sys] | (t.spread[par1] >> 1) | (t.spread[par2] >> 2);
+                outputBytes[3 * i + 0] = static_cast<uint8_t>(bits >> 16);
+                outputBytes[3 * i + 1] = static_cast<uint8_t>(bits >> 8);
+                outputBytes[3 * i + 2] = static_cast<uint8_t>(bits);
+            }
+            
+            // Terminate both encoders
+            uint64_t tail = 0;
+            for (TShiftReg *state : { &state1, &state2 }) {
+                for (uint32_t i = 0; i < (ConstraintLength - 1); i++) {
+                    uint8_t in = ConstituentEncoder::terminationBit(*state);
+                    uint8_t par;
+                    *state = ConstituentEncoder::step(*state, in, &par);
+                    tail = (tail << 2) | (in << 1) | par;
+                }
+            }
+            assert(state1 == 0 && state2 == 0);
+            
+            // Put the termination bits to the end of the output
+            uint8_t *tailOutput = outputBytes + 3 * n;
+            uint32_t tailBytes = (tailBitCount / 8) + ((tailBitCount % 8) ? 1 : 0);
+            tail <<= (tailBytes * 8 - tailBitCount);
+            for (uint32_t i = 0; i < tailBytes; i++) {
+                tailOutput[i] = static_cast<uint8_t>(tail >> (8 * (tailBytes - 1 - i)));
+            }
+        }
+        
+    };
+    
+    /**
+     * @brief The turbo encoder used by LTE and UMTS, with 8-state constituent codes.
+     */
+    using LteTurboEncoder = TurboEncoder<4, uint8_t, 0xb, 0xd>;
+
+}
+
+#endif // FECMAGIC_TURBO_ENCODER_H
@@ -291,6 +291,11 @@ void matrixProductTests2() {
     randomMatrixProductTest<8, 8, 8>();
 }
 
+// Only brace lists and explicit construction make a matrix from bytes
+static_assert(!std::is_convertible<int, BinaryMatrix<8, 8>>::value, "An integer must not be converted to a matrix implicitly.");
+static_assert(std::is_constructible<BinaryMatrix<8, 8>, int>::value, "A matrix must be constructible from its first byte.");
+static_assert(BinaryMatrix<8, 8>{ 1, 2, 3 }.getBytes()[2] == 3, "A matrix must be constructible from a list of bytes at compile time.");
+
 int main() {
     transposeTests1();
     transposeTests2();
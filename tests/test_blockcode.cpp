@@ -0,0 +1,245 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "../src/hamming.h"
+#include "../src/golay.h"
+
+using namespace std;
+using namespace fecmagic;
+
+// A systematic code with 32-bit source blocks, which is too large for encoding tables,
+// so it is encoded with matrix products and bit slicing.
+// Each parity bit is the XOR of two neighbouring source bits.
+class WideParityCode final : public BlockCode<WideParityCode, 0, uint64_t, uint32_t, uint32_t> {
+private:
+    static GeneratorMatrix createGenerator() {
+        GeneratorMatrix generator;
+        for (unsigned i = 0; i < 32; i++) {
+            generator.setBit(i, i, 1);
+            generator.setBit(32 + i, i, 1);
+            generator.setBit(32 + i, (i + 1) % 32, 1);
+        }
+        return generator;
+    }
+
+public:
+    static const GeneratorMatrix &generatorMatrix() {
+        static const GeneratorMatrix m = createGenerator();
+        return m;
+    }
+    
+    // Only encoding is tested with this code
+    static const ParityCheckMatrix &parityCheckMatrix() {
+        static const ParityCheckMatrix m;
+        return m;
+    }
+    
+    static const DecoderMatrix &decoderMatrix() {
+        static const DecoderMatrix m;
+        return m;
+    }
+};
+
+// A code with the matrices of another code (whose codeword doesn't fill its type) and a
+// different number of corrected errors, with the trial and error helpers made public
+// to compare them to the decoding tables.
+template<typename TBase, unsigned MaxCorrectedErrors>
+class TableTestCode final : public BlockCode<TableTestCode<TBase, MaxCorrectedErrors>, MaxCorrectedErrors, typename TBase::Codeword, typename TBase::SourceBlock, typename TBase::Syndrome> {
+public:
+    typedef BlockCode<TableTestCode<TBase, MaxCorrectedErrors>, MaxCorrectedErrors, typename TBase::Codeword, typename TBase::SourceBlock, typename TBase::Syndrome> Base;
+    
+    using Base::calculateSyndrome;
+    using Base::calculateSourceBlock;
+    using Base::fixCodeword;
+    
+    static const typename Base::GeneratorMatrix &generatorMatrix() {
+        return TBase::generatorMatrix();
+    }
+    
+    static const typename Base::ParityCheckMatrix &parityCheckMatrix() {
+        return TBase::parityCheckMatrix();
+    }
+    
+    static const typename Base::DecoderMatrix &decoderMatrix() {
+        return TBase::decoderMatrix();
+    }
+};
+
+template<typename TCode>
+void testDecodingTables(unsigned maxErrors, size_t syndromeCount) {
+    typedef typename TCode::Codeword Codeword;
+    typedef typename TCode::SourceBlock SourceBlock;
+    typedef typename TCode::Syndrome Syndrome;
+    
+    TCode code;
+    vector<bool> syndromesSeen(static_cast<size_t>(1) << (sizeof(Syndrome) * 8), false);
+    
+    // Every error pattern up to the given weight on a random codeword, including the bits that aren't part of the code
+    vector<Codeword> masks(1, 0);
+    for (unsigned errors = 1; errors <= maxErrors; errors++) {
+        BitmaskCombination<Codeword, 4> b(errors);
+        for (Codeword mask = b.next(); mask != 0; mask = b.next()) {
+            masks.push_back(mask);
+        }
+    }
+    
+    for (Codeword mask : masks) {
+        SourceBlock source = static_cast<SourceBlock>(rand() & ((1 << code.sourceBlockLength()) - 1));
+        Codeword input = code.encode(source) ^ mask;
+        
+        // The decoding of the base class, which uses the tables
+        bool success;
+        SourceBlock decoded = code.decode(input, success);
+        
+        // Trial and error
+        Syndrome syndrome = TCode::calculateSyndrome(input);
+        bool expectedSuccess = true;
+        Codeword fixed = (syndrome == 0) ? input : TCode::fixCodeword(input, syndrome, expectedSuccess);
+        
+        syndromesSeen[syndrome] = true;
+        assert(success == expectedSuccess);
+        assert(!success || decoded == TCode::calculateSourceBlock(fixed));
+    }
+    
+    // Every syndrome of the code was checked
+    assert(static_cast<size_t>(count(syndromesSeen.begin(), syndromesSeen.end(), true)) == syndromeCount);
+}
+
+template<typename TCode, typename TSourceBlock, typename TCodeword>
+void testEncodeBatch(const TCode &code, TSourceBlock sourceMask) {
+    // Different counts to cover partial groups of 64
+    for (size_t count : { 0, 1, 7, 63, 64, 65, 200 }) {
+        vector<TSourceBlock> input(count);
+        for (size_t i = 0; i < count; i++) {
+            input[i] = static_cast<TSourceBlock>(rand()) & sourceMask;
+        }
+        
+        vector<TCodeword> output(count + 1, 0);
+        output[count] = 0x55;
+        code.encodeBatch(input.data(), count, output.data());
+        
+        for (size_t i = 0; i < count; i++) {
+            if (output[i] != code.encode(input[i])) {
+                cout << "FAIL! Batch encoding differs at codeword " << i << " of " << count << endl
+                    << hex
+                    << " the input=\t" << static_cast<uint64_t>(input[i]) << endl
+                    << " expected=\t" << static_cast<uint64_t>(code.encode(input[i])) << endl
+                    << " output=\t" << static_cast<uint64_t>(output[i]) << endl;
+            }
+            assert(output[i] == code.encode(input[i]));
+        }
+        
+        // Nothing is written past the end
+        assert(output[count] == 0x55);
+    }
+}
+
+// Flips the given bit of a packed bit stream, MSB first
+void flipBit(vector<uint8_t> &stream, size_t bit) {
+    stream[bit / 8] ^= static_cast<uint8_t>(0x80 >> (bit % 8));
+}
+
+template<typename TCode>
+void testBuffers(const TCode &code, unsigned uncorrectableErrors) {
+    for (size_t size = 0; size <= 50; size++) {
+        vector<uint8_t> input(size);
+        for (size_t i = 0; i < size; i++) {
+            input[i] = static_cast<uint8_t>(rand());
+        }
+        
+        size_t blockCount = code.calculateBlockCount(size);
+        vector<uint8_t> encoded(code.calculateEncodedSize(size));
+        code.encodeBuffer(input.data(), size, encoded.data());
+        
+        // Correct a single error in every other codeword
+        for (size_t i = 0; i < blockCount; i += 2) {
+            flipBit(encoded, i * code.codewordLength() + rand() % code.codewordLength());
+        }
+        
+        vector<uint8_t> decoded(size);
+        vector<uint8_t> status((blockCount + 7) / 8);
+        size_t failedBlocks = code.decodeBuffer(encoded.data(), size, decoded.data(), status.data());
+        assert(failedBlocks == 0);
+        assert(decoded == input);
+        for (uint8_t x : status) {
+            assert(x == 0);
+        }
+        
+        // Detect errors in the last codeword, when the code can
+        if (uncorrectableErrors != 0 && blockCount != 0) {
+            code.encodeBuffer(input.data(), size, encoded.data());
+            for (unsigned i = 0; i < uncorrectableErrors; i++) {
+                flipBit(encoded, (blockCount - 1) * code.codewordLength() + i);
+            }
+            failedBlocks = code.decodeBuffer(encoded.data(), size, decoded.data(), status.data());
+            assert(failedBlocks == 1);
+            assert(status[(blockCount - 1) / 8] == (0x80 >> ((blockCount - 1) % 8)));
+        }
+    }
+}
+
+int main() {
+    HammingCode hamming;
+    testEncodeBatch<HammingCode, uint8_t, uint8_t>(hamming, 0x0f);
+    
+    GolayCode golay;
+    testEncodeBatch<GolayCode, uint16_t, uint32_t>(golay, 0x0fff);
+    
+    WideParityCode wide;
+    assert(wide.encode(0x80000001u) == 0x8000000180000002ull);
+    testEncodeBatch<WideParityCode, uint32_t, uint64_t>(wide, 0xffffffffu);
+    
+    cout << "Bit-sliced batch encoding works." << endl;
+    
+    // Golay packs two 12-bit blocks from 3 bytes into two 24-bit codewords
+    assert(golay.sourceBlockLength() == 12 && golay.codewordLength() == 24);
+    uint8_t bytes[3] = { 0xab, 0xcd, 0xef };
+    uint8_t packed[6];
+    golay.encodeBuffer(bytes, 3, packed);
+    uint32_t first = (packed[0] << 16) | (packed[1] << 8) | packed[2];
+    uint32_t second = (packed[3] << 16) | (packed[4] << 8) | packed[5];
+    assert(first == golay.encode(0xabc) && second == golay.encode(0xdef));
+    
+    assert(hamming.sourceBlockLength() == 4 && hamming.codewordLength() == 7);
+    testBuffers(hamming, 0);
+    testBuffers(golay, 4);
+    
+    cout << "Buffer encoding and decoding works." << endl;
+    
+    // Hamming has an unused top bit, every syndrome is reached by flipping one or two bits
+    testDecodingTables<TableTestCode<HammingCode, 1>>(2, 8);
+    // With 2 corrected errors, every pair of errors has the syndrome of a single error,
+    // and the single error must be corrected
+    testDecodingTables<TableTestCode<HammingCode, 2>>(3, 8);
+    // Golay has 8 unused bits, the syndromes of 3 or 4 errors are uncorrectable with 2 corrected errors
+    testDecodingTables<TableTestCode<GolayCode, 2>>(4, 4096);
+    
+    cout << "Decoding tables agree with trial and error." << endl;
+    
+    return 0;
+}
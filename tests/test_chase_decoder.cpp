@@ -0,0 +1,146 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the Chase-II decoder of fecmagic with the Golay and Hamming codes.
+// Errors on the least reliable bits beyond the hard decoding capability are corrected,
+// and with BPSK over a noisy channel, fewer codewords are lost than with hard decoding.
+
+#include "../src/golay.h"
+#include "../src/hamming.h"
+#include "../src/chase-decoder.h"
+#include "../src/demapper.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+using namespace fecmagic;
+
+// Creates the LLRs of a codeword of the given length, MSB first, with the given magnitude
+template<typename TCodeword>
+void codewordToLlr(TCodeword codeword, unsigned n, int8_t magnitude, int8_t *llr) {
+    for (unsigned i = 0; i < n; i++) {
+        llr[i] = ((codeword >> (n - 1 - i)) & 1) ? -magnitude : magnitude;
+    }
+}
+
+// Flips weak errors into the given LLR positions, then decodes with both decoders
+template<typename TCode>
+void testWeakErrors(const vector<unsigned> &positions, bool hardShouldFail) {
+    TCode code;
+    ChaseDecoder<TCode, 4> chase;
+    unsigned n = code.codewordLength();
+    
+    for (unsigned data = 0; data < (1u << code.sourceBlockLength()); data += 7) {
+        auto codeword = code.encode(static_cast<typename TCode::SourceBlock>(data));
+        int8_t llr[32];
+        codewordToLlr(codeword, n, 100, llr);
+        
+        auto received = codeword;
+        for (unsigned p : positions) {
+            llr[p] = (llr[p] > 0) ? -3 : 3;
+            received ^= static_cast<decltype(received)>(1) << (n - 1 - p);
+        }
+        
+        bool hardSuccess;
+        auto hard = code.decode(received, hardSuccess);
+        if (hardShouldFail) {
+            assert(!hardSuccess || hard != data);
+        }
+        
+        bool success;
+        auto decoded = chase.decode(llr, success);
+        assert(success);
+        assert(decoded == data);
+    }
+}
+
+// Counts the codewords lost with hard and Chase decoding, with BPSK over a noisy channel
+template<typename TCode>
+void countLostCodewords(float ebn0Db, unsigned codewordCount, unsigned &hardLost, unsigned &chaseLost) {
+    TCode code;
+    ChaseDecoder<TCode, 4> chase;
+    unsigned n = code.codewordLength();
+    float rate = static_cast<float>(code.sourceBlockLength()) / n;
+    float variance = 1.0f / (2.0f * rate * pow(10.0f, ebn0Db / 10.0f));
+    SoftDemapper demapper(Modulation::Bpsk, variance, 4.0f);
+    
+    mt19937 generator(42);
+    normal_distribution<float> noise(0.0f, sqrt(variance));
+    hardLost = chaseLost = 0;
+    
+    for (unsigned c = 0; c < codewordCount; c++) {
+        auto data = static_cast<typename TCode::SourceBlock>(generator() & ((1u << code.sourceBlockLength()) - 1));
+        auto codeword = code.encode(data);
+        
+        float samples[32];
+        for (unsigned i = 0; i < n; i++) {
+            samples[i] = (((codeword >> (n - 1 - i)) & 1) ? -1.0f : 1.0f) + noise(generator);
+        }
+        int8_t llr[32];
+        demapper.demap(samples, n, llr);
+        
+        decltype(codeword) received = 0;
+        for (unsigned i = 0; i < n; i++) {
+            received = static_cast<decltype(codeword)>((received << 1) | (llr[i] < 0));
+        }
+        bool success;
+        hardLost += (code.decode(received, success) != data || !success);
+        chaseLost += (chase.decode(llr, success) != data || !success);
+    }
+}
+
+int main() {
+    // Error-free codewords
+    testWeakErrors<GolayCode>({}, false);
+    testWeakErrors<HammingCode>({}, false);
+    
+    // Within the hard decoding capability
+    testWeakErrors<GolayCode>({ 0, 5, 17 }, false);
+    testWeakErrors<HammingCode>({ 2 }, false);
+    
+    // Beyond it, but on the least reliable bits
+    testWeakErrors<GolayCode>({ 1, 6, 11, 23 }, true);
+    testWeakErrors<GolayCode>({ 1, 2, 6, 11, 23 }, true);
+    testWeakErrors<HammingCode>({ 0, 4 }, true);
+    
+    cout << "Weak errors beyond the hard decoding capability are corrected." << endl;
+    
+    unsigned hardLost, chaseLost;
+    countLostCodewords<GolayCode>(4.0f, 20000, hardLost, chaseLost);
+    cout << "Golay(24, 12) at Eb/N0 = 4 dB, lost codewords: hard " << hardLost << ", Chase-II " << chaseLost << endl;
+    assert(chaseLost * 2 < hardLost);
+    
+    countLostCodewords<HammingCode>(4.0f, 20000, hardLost, chaseLost);
+    cout << "Hamming(7, 4) at Eb/N0 = 4 dB, lost codewords: hard " << hardLost << ", Chase-II " << chaseLost << endl;
+    assert(chaseLost * 2 < hardLost);
+    
+    return 0;
+}
@@ -25,9 +25,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <random>
+#include <vector>
 #include "../src/binaryprint.h"
 #include "../src/convolutional-encoder.h"
 #include "../src/convolutional-decoder.h"
+#include "../src/outputsink.h"
 
 //#define TEST_CONVOLUTIONAL_DECODER_DEBUG
 #ifdef TEST_CONVOLUTIONAL_DECODER_DEBUG
@@ -206,6 +208,158 @@ bool testPuncturingSimple(const void *input, size_t inputSize) {
     
 }
 
+bool testStatistics(const char *data) {
+    ConvolutionalEncoder<7, uint8_t, poly1, poly2> enc;
+    ConvolutionalDecoder<100, 7, uint8_t, poly1, poly2> dec;
+    
+    size_t dataSize = strlen(data) + 1;
+    size_t encodedSize = decltype(enc)::calculateOutputSize(dataSize);
+    size_t decodedSize = decltype(dec)::calculateOutputSize(encodedSize);
+    uint8_t *encOutput = new uint8_t[encodedSize];
+    uint8_t *decOutput = new uint8_t[decodedSize];
+    
+    enc.reset(encOutput);
+    enc.encode(data, dataSize);
+    enc.flush();
+    
+    // Add bit errors that are far enough apart to be corrected
+    constexpr uint32_t errorCount = 3;
+    encOutput[2] ^= 0x10;
+    encOutput[encodedSize / 2] ^= 0x01;
+    encOutput[encodedSize - 10] ^= 0x40;
+    
+    dec.setReencodingCheckEnabled(true);
+    dec.reset(decOutput);
+    dec.decode(encOutput, encodedSize);
+    dec.flush();
+    
+    const ConvolutionalDecoderStatistics &stats = dec.statistics();
+    DEBUG_PRINT("steps=" << stats.steps << " received=" << stats.receivedBits << " pm=" << stats.pathMetricErrors << " reenc=" << stats.reencodedBits << " reencerr=" << stats.reencodingErrors);
+    
+    bool success = (0 == memcmp(decOutput, data, dataSize));
+    success = success && (stats.receivedBits == encodedSize * 8);
+    success = success && (stats.pathMetricErrors == errorCount);
+    success = success && (stats.reencodedBits == stats.receivedBits);
+    success = success && (stats.reencodingErrors == errorCount);
+    
+    // Statistics are kept until they are explicitly cleared
+    dec.resetStatistics();
+    success = success && (dec.statistics().steps == 0);
+    
+    delete [] encOutput;
+    delete [] decOutput;
+    
+    return success;
+}
+
+bool testErasures(const char *data) {
+    ConvolutionalEncoder<7, uint8_t, poly1, poly2> enc;
+    ConvolutionalDecoder<100, 7, uint8_t, poly1, poly2> dec;
+    
+    size_t dataSize = strlen(data) + 1;
+    size_t encodedSize = decltype(enc)::calculateOutputSize(dataSize);
+    size_t decodedSize = decltype(dec)::calculateOutputSize(encodedSize);
+    uint8_t *encOutput = new uint8_t[encodedSize];
+    uint8_t *erasures = new uint8_t[encodedSize];
+    uint8_t *decOutput = new uint8_t[decodedSize];
+    
+    enc.reset(encOutput);
+    enc.encode(data, dataSize);
+    enc.flush();
+    
+    // Blank out whole bytes in a few places and mark them as erased
+    memset(erasures, 0, encodedSize);
+    for (size_t i = 3; i < encodedSize; i += 9) {
+        encOutput[i] = 0xff;
+        erasures[i] = 0xff;
+    }
+    
+    dec.reset(decOutput);
+    dec.decode(encOutput, encodedSize, erasures);
+    dec.flush();
+    
+    // Erased bits must not count as received
+    bool success = (0 == memcmp(decOutput, data, dataSize));
+    success = success && (dec.statistics().pathMetricErrors == 0);
+    
+    delete [] encOutput;
+    delete [] erasures;
+    delete [] decOutput;
+    
+    return success;
+}
+
+bool testSinkStreaming(size_t dataSize) {
+    // Punctured code, so that symbols don't align with bytes
+    typedef PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1, 1, 0>, 7, uint8_t, poly1, poly2> Encoder;
+    typedef PuncturedConvolutionalDecoder<Sequence<uint8_t, 1, 1, 0, 1, 1, 0>, 100, 7, uint8_t, poly1, poly2> Decoder;
+    Encoder enc;
+    Decoder dec;
+    
+    vector<uint8_t> data(dataSize);
+    for (auto &b : data) {
+        b = rand() % 256;
+    }
+    
+    // Encode with the byte-oriented API
+    size_t encodedSize = Encoder::calculateOutputSize(dataSize);
+    size_t encodedBits = Encoder::calculateSymbolCount(dataSize);
+    vector<uint8_t> encoded(encodedSize);
+    enc.reset(encoded.data());
+    enc.encode(data.data(), dataSize);
+    enc.flush();
+    
+    // Encode random bit-sized pieces into a ring buffer, and read it as we go
+    RingBufferSink ring(100);
+    vector<uint8_t> sinkEncoded;
+    uint8_t readBuffer[100];
+    enc.reset(nullptr);
+    size_t pos = 0;
+    while (pos < dataSize * 8) {
+        size_t n = std::min(dataSize * 8 - pos, static_cast<size_t>(rand() % 80));
+        enc.encodeBits(data.data(), pos, n, ring);
+        pos += n;
+        size_t r = ring.read(readBuffer, sizeof(readBuffer));
+        sinkEncoded.insert(sinkEncoded.end(), readBuffer, readBuffer + r);
+    }
+    enc.flushBits(ring);
+    size_t r = ring.read(readBuffer, sizeof(readBuffer));
+    sinkEncoded.insert(sinkEncoded.end(), readBuffer, readBuffer + r);
+    
+    if (sinkEncoded != encoded) {
+        return false;
+    }
+    
+    // Decode random bit-sized pieces (without the padding at the end) through a callback
+    vector<uint8_t> decoded;
+    CallbackSink callback([&decoded](const uint8_t *d, size_t size) {
+        decoded.insert(decoded.end(), d, d + size);
+    });
+    dec.reset(nullptr);
+    pos = 0;
+    while (pos < encodedBits) {
+        size_t n = std::min(encodedBits - pos, static_cast<size_t>(rand() % 80));
+        dec.decodeBits(encoded.data(), pos, n, callback);
+        pos += n;
+    }
+    dec.flushBits(callback);
+    
+    if (decoded.size() < dataSize || 0 != memcmp(decoded.data(), data.data(), dataSize)) {
+        return false;
+    }
+    
+    // Decode at once into a few memory segments
+    vector<uint8_t> part1(dataSize / 3), part2(dataSize + 10 - part1.size());
+    Iovec segments[] = { { part1.data(), part1.size() }, { part2.data(), part2.size() } };
+    IovecSink iovec(segments, 2);
+    dec.reset(nullptr);
+    dec.decodeBits(encoded.data(), 0, encodedBits, iovec);
+    dec.flushBits(iovec);
+    
+    part1.insert(part1.end(), part2.begin(), part2.end());
+    return iovec.size() == decoded.size() && 0 == memcmp(part1.data(), decoded.data(), decoded.size());
+}
+
 int main() {
     cout << "Testing basic functionality (k=3, rate=1/3)" << endl;
     ConvolutionalEncoder<3, uint8_t, 7, 3, 5> enc2;
@@ -253,6 +407,20 @@ int main() {
     }
     cout << "OK" << endl;
     
+    cout << "Testing link quality statistics" << endl;
+    assert(testStatistics("Hello world! Are we awesome yet?"));
+    cout << "OK" << endl;
+    
+    cout << "Testing erasures" << endl;
+    assert(testErasures("Hello world! Are we awesome yet?"));
+    cout << "OK" << endl;
+    
+    cout << "Testing bit-granular streaming with sinks" << endl;
+    for (uint32_t i = 0; i < 50; i++) {
+        assert(testSinkStreaming(1 + rand() % 300));
+    }
+    cout << "OK" << endl;
+    
     cout << "Puncturing / simple" << endl;
     cout << testPuncturingSimple("Hello, world!", sizeof("Hello, world!")) << endl;
     
@@ -0,0 +1,157 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the convolutional decoder engine of fecmagic. A single engine
+// decodes many channels at the same time, each with its own context, and the
+// input of the channels is fed to it in small, interleaved chunks.
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/convolutional-decoder-engine.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+constexpr uint8_t poly1 = 0x6d;
+constexpr uint8_t poly2 = 0x4f;
+
+template<typename TEncoder, typename TEngine>
+bool testChannels(const TEngine &engine, uint32_t channelCount, uint32_t errorCount, bool useErasures) {
+    vector<vector<uint8_t>> inputs(channelCount);
+    vector<vector<uint8_t>> encoded(channelCount);
+    vector<vector<uint8_t>> erasures(channelCount);
+    vector<vector<uint8_t>> outputs(channelCount);
+    vector<typename TEngine::Context> contexts(channelCount);
+    vector<size_t> positions(channelCount, 0);
+    
+    for (uint32_t c = 0; c < channelCount; c++) {
+        inputs[c].resize((errorCount == 0) ? (1 + rand() % 500) : (100 + rand() % 400));
+        for (auto &b : inputs[c]) {
+            b = rand() % 256;
+        }
+        
+        encoded[c].resize(TEncoder::calculateOutputSize(inputs[c].size()));
+        TEncoder encoder(encoded[c].data());
+        encoder.encode(inputs[c].data(), inputs[c].size());
+        encoder.flush();
+        
+        // Flip or erase bits far enough from each other that they can be corrected
+        erasures[c].resize(encoded[c].size(), 0);
+        size_t spacing = encoded[c].size() * 8 / (errorCount + 1);
+        for (uint32_t i = 0; i < errorCount; i++) {
+            size_t pos = spacing * (i + 1) + rand() % 8;
+            if (useErasures) {
+                erasures[c][pos / 8] |= (1 << (7 - pos % 8));
+                encoded[c][pos / 8] ^= ((rand() % 2) << (7 - pos % 8));
+            }
+            else {
+                encoded[c][pos / 8] ^= (1 << (7 - pos % 8));
+            }
+        }
+        
+        outputs[c].resize(TEngine::calculateOutputSize(encoded[c].size()));
+        engine.reset(contexts[c], outputs[c].data());
+    }
+    
+    // Feed the channels in a round robin fashion
+    bool remaining = true;
+    while (remaining) {
+        remaining = false;
+        for (uint32_t c = 0; c < channelCount; c++) {
+            size_t chunk = min(static_cast<size_t>(1 + rand() % 20), encoded[c].size() - positions[c]);
+            if (chunk == 0) {
+                continue;
+            }
+            
+            if (useErasures) {
+                engine.decode(contexts[c], encoded[c].data() + positions[c], chunk, erasures[c].data() + positions[c]);
+            }
+            else {
+                engine.decode(contexts[c], encoded[c].data() + positions[c], chunk);
+            }
+            positions[c] += chunk;
+            remaining = true;
+        }
+    }
+    
+    for (uint32_t c = 0; c < channelCount; c++) {
+        engine.flush(contexts[c]);
+        if (0 != memcmp(outputs[c].data(), inputs[c].data(), inputs[c].size())) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+int main() {
+    srand(time(0));
+    
+    typedef ConvolutionalEncoder<7, uint8_t, poly1, poly2> Encoder7;
+    typedef ConvolutionalDecoderEngine<35, 7, uint8_t, poly1, poly2> Engine7;
+    typedef ConvolutionalEncoder<3, uint8_t, 7, 3, 5> Encoder3;
+    typedef ConvolutionalDecoderEngine<15, 3, uint8_t, 7, 3, 5> Engine3;
+    typedef PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1, 1, 0>, 7, uint8_t, poly1, poly2> EncoderPunctured;
+    typedef PuncturedConvolutionalDecoderEngine<Sequence<uint8_t, 1, 1, 0, 1, 1, 0>, 50, 7, uint8_t, poly1, poly2> EnginePunctured;
+    typedef ConvolutionalEncoder<9, uint16_t, 0x1af, 0x11d> Encoder9;
+    typedef ConvolutionalDecoderEngine<45, 9, uint16_t, 0x1af, 0x11d> Engine9;
+    
+    Engine7 engine7;
+    Engine3 engine3;
+    EnginePunctured enginePunctured;
+    Engine9 engine9;
+    
+    cout << "Without errors: ";
+    for (uint32_t i = 0; i < 10; i++) {
+        assert((testChannels<Encoder7>(engine7, 20, 0, false)));
+        assert((testChannels<Encoder3>(engine3, 20, 0, false)));
+        assert((testChannels<EncoderPunctured>(enginePunctured, 20, 0, false)));
+        assert((testChannels<Encoder9>(engine9, 20, 0, false)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "With errors: ";
+    for (uint32_t i = 0; i < 10; i++) {
+        assert((testChannels<Encoder7>(engine7, 20, 5, false)));
+        assert((testChannels<Encoder3>(engine3, 20, 2, false)));
+        assert((testChannels<EncoderPunctured>(enginePunctured, 20, 2, false)));
+        assert((testChannels<Encoder9>(engine9, 20, 5, false)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "With erasures: ";
+    for (uint32_t i = 0; i < 10; i++) {
+        assert((testChannels<Encoder7>(engine7, 20, 10, true)));
+        assert((testChannels<EncoderPunctured>(enginePunctured, 20, 3, true)));
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
@@ -325,6 +325,95 @@ bool testPuncturedSimple(const char *input) {
     return true;
 }
 
+bool testSymbols() {
+    // Puncturing makes sure that the symbol count is computed correctly
+    typedef PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1>, 7, uint8_t, poly1, poly2> Encoder;
+    Encoder encoder;
+    
+    size_t inputSize = 1 + rand() % 100;
+    uint8_t *input = new uint8_t[inputSize];
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rand() % 256;
+    }
+    
+    // Encode into bytes
+    size_t outputSize = Encoder::calculateOutputSize(inputSize);
+    uint8_t *output = new uint8_t[outputSize];
+    encoder.reset(output);
+    encoder.encode(input, inputSize / 2);
+    encoder.encode(input + inputSize / 2, inputSize - inputSize / 2);
+    encoder.flush();
+    
+    // Encode into int8_t symbols, in two parts
+    size_t symbolCount = Encoder::calculateSymbolCount(inputSize);
+    int8_t *symbols = new int8_t[symbolCount];
+    encoder.reset(nullptr);
+    size_t written = encoder.encodeToSymbols(input, inputSize / 2, symbols, static_cast<int8_t>(100));
+    written += encoder.encodeToSymbols(input + inputSize / 2, inputSize - inputSize / 2, symbols + written, static_cast<int8_t>(100));
+    written += encoder.flushToSymbols(symbols + written, static_cast<int8_t>(100));
+    
+    // Encode into float symbols
+    float *floatSymbols = new float[symbolCount];
+    encoder.reset(nullptr);
+    size_t floatWritten = encoder.encodeToSymbols(input, inputSize, floatSymbols, 0.5f);
+    floatWritten += encoder.flushToSymbols(floatSymbols + floatWritten, 0.5f);
+    
+    bool success = (written == symbolCount) && (floatWritten == symbolCount);
+    for (size_t i = 0; success && i < symbolCount; i++) {
+        uint8_t bit = (output[i / 8] >> (7 - i % 8)) & 1;
+        success = (symbols[i] == (bit ? -100 : 100)) && (floatSymbols[i] == (bit ? -0.5f : 0.5f));
+    }
+    
+    delete [] input;
+    delete [] output;
+    delete [] symbols;
+    delete [] floatSymbols;
+    
+    return success;
+}
+
+template<typename TEncoder>
+bool testWordParallel() {
+    // The symbol output always encodes bit by bit, so it is the reference
+    TEncoder encoder;
+    
+    size_t inputSize = 1 + rand() % 300;
+    uint8_t *input = new uint8_t[inputSize];
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rand() % 256;
+    }
+    
+    size_t symbolCount = TEncoder::calculateSymbolCount(inputSize);
+    int8_t *symbols = new int8_t[symbolCount];
+    encoder.reset(nullptr);
+    size_t written = encoder.encodeToSymbols(input, inputSize, symbols, static_cast<int8_t>(1));
+    written += encoder.flushToSymbols(symbols + written, static_cast<int8_t>(1));
+    
+    // Encode in random sized pieces, which uses the word-parallel path when possible
+    size_t outputSize = TEncoder::calculateOutputSize(inputSize);
+    uint8_t *output = new uint8_t[outputSize];
+    encoder.reset(output);
+    size_t pos = 0;
+    while (pos < inputSize) {
+        size_t size = std::min(inputSize - pos, static_cast<size_t>(rand() % 40));
+        encoder.encode(input + pos, size);
+        pos += size;
+    }
+    encoder.flush();
+    
+    bool success = (written == symbolCount);
+    for (size_t i = 0; success && i < symbolCount; i++) {
+        uint8_t bit = (output[i / 8] >> (7 - i % 8)) & 1;
+        success = (symbols[i] == (bit ? -1 : 1));
+    }
+    
+    delete [] input;
+    delete [] output;
+    delete [] symbols;
+    
+    return success;
+}
+
 int main() {
     srand(time(0));
     
@@ -380,5 +469,21 @@ int main() {
     
     cout << "Simple punctured encoding: " << testPuncturedSimple("Hello, world!") << endl;
     
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(testSymbols());
+    }
+    cout << "Symbol output: ok" << endl;
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        assert((testWordParallel<ConvolutionalEncoder<7, uint8_t, poly1, poly2>>()));
+        assert((testWordParallel<ConvolutionalEncoder<3, uint8_t, 7, 5>>()));
+        assert((testWordParallel<ConvolutionalEncoder<9, uint16_t, 0x1af, 0x11d, 0x1ed>>()));
+        assert((testWordParallel<ConvolutionalEncoder<15, uint16_t, 0x4599, 0x6cb7, 0x7d35, 0x4f19, 0x5d73, 0x65af, 0x7b4d, 0x4923>>()));
+        assert((testWordParallel<PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1>, 7, uint8_t, poly1, poly2>>()));
+        assert((testWordParallel<PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 1, 0, 0, 1>, 7, uint8_t, poly1, poly2>>()));
+        assert((testWordParallel<PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1, 1>, 9, uint16_t, 0x1af, 0x11d, 0x1ed>>()));
+    }
+    cout << "Word-parallel encoding: ok" << endl;
+    
     return 0;
 }
@@ -0,0 +1,184 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the soft demapper of fecmagic. The LLRs are compared to a brute
+// force max-log computation over all constellation points, then noisy 16-QAM
+// samples of a turbo encoded block are demapped and decoded.
+
+#include "helper.h"
+#include "../src/demapper.h"
+#include "../src/turbo-encoder.h"
+#include "../src/turbo-decoder.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using namespace std;
+using namespace fecmagic;
+
+// Returns the constellation point (I and Q) of the given bits, MSB is the first bit
+void modulate(Modulation modulation, uint32_t bits, float &i, float &q) {
+    switch (modulation) {
+    case Modulation::Bpsk:
+        i = (bits & 1) ? -1.0f : 1.0f;
+        q = 0.0f;
+        break;
+    case Modulation::Qpsk:
+        i = ((bits & 2) ? -1.0f : 1.0f) / sqrt(2.0f);
+        q = ((bits & 1) ? -1.0f : 1.0f) / sqrt(2.0f);
+        break;
+    case Modulation::Qam16:
+        i = ((bits & 8) ? -1.0f : 1.0f) * ((bits & 2) ? 3.0f : 1.0f) / sqrt(10.0f);
+        q = ((bits & 4) ? -1.0f : 1.0f) * ((bits & 1) ? 3.0f : 1.0f) / sqrt(10.0f);
+        break;
+    }
+}
+
+// Computes the LLRs of a symbol by finding the closest points where each bit is 0 and 1
+void referenceLlr(Modulation modulation, uint32_t bitsPerSymbol, float i, float q, float variance, float scale, int8_t *llr) {
+    for (uint32_t b = 0; b < bitsPerSymbol; b++) {
+        float closest[2] = { 1e30f, 1e30f };
+        for (uint32_t bits = 0; bits < (1u << bitsPerSymbol); bits++) {
+            float pi, pq;
+            modulate(modulation, bits, pi, pq);
+            float d = (i - pi) * (i - pi) + (modulation == Modulation::Bpsk ? 0.0f : (q - pq) * (q - pq));
+            uint32_t bit = (bits >> (bitsPerSymbol - 1 - b)) & 1;
+            closest[bit] = min(closest[bit], d);
+        }
+        float l = (closest[1] - closest[0]) / (2.0f * variance) * scale;
+        llr[b] = static_cast<int8_t>(nearbyint(max(min(l, 127.0f), -127.0f)));
+    }
+}
+
+bool testAgainstReference(Modulation modulation, mt19937 &rng) {
+    uniform_real_distribution<float> sampleDist(-2.0f, 2.0f);
+    uniform_real_distribution<float> varianceDist(0.01f, 1.0f);
+    SoftDemapper demapper(modulation);
+    demapper.setNoiseVariance(varianceDist(rng));
+    demapper.setScale(1.0f + rng() % 16);
+    
+    size_t symbolCount = rng() % 100;
+    vector<float> samples(symbolCount * demapper.samplesPerSymbol() + 1);
+    for (auto &s : samples) {
+        s = sampleDist(rng);
+    }
+    
+    vector<int8_t> llr(symbolCount * demapper.bitsPerSymbol() + 1);
+    if (demapper.demap(samples.data(), symbolCount, llr.data()) != symbolCount * demapper.bitsPerSymbol()) {
+        return false;
+    }
+    
+    for (size_t s = 0; s < symbolCount; s++) {
+        int8_t expected[4];
+        float i = samples[s * demapper.samplesPerSymbol()];
+        float q = (modulation == Modulation::Bpsk) ? 0.0f : samples[s * 2 + 1];
+        referenceLlr(modulation, demapper.bitsPerSymbol(), i, q, demapper.noiseVariance(), demapper.scale(), expected);
+        
+        // Allow a difference of 1 for rounding
+        for (uint32_t b = 0; b < demapper.bitsPerSymbol(); b++) {
+            if (abs(llr[s * demapper.bitsPerSymbol() + b] - expected[b]) > 1) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool testTurbo16Qam(mt19937 &rng) {
+    QppInterleaver interleaver(1024, 31, 64);
+    LteTurboEncoder encoder(interleaver);
+    LteTurboDecoder<> decoder(interleaver, 8);
+    size_t inputSize = encoder.blockSize();
+    
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rng() % 256;
+    }
+    vector<uint8_t> encoded(LteTurboEncoder::calculateOutputSize(inputSize));
+    encoder.encode(input.data(), encoded.data());
+    
+    // Modulate with added noise
+    float variance = 0.15f;
+    normal_distribution<float> noise(0.0f, sqrt(variance));
+    size_t symbolCount = (decoder.inputSize() + 3) / 4;
+    vector<float> samples(symbolCount * 2);
+    for (size_t s = 0; s < symbolCount; s++) {
+        uint32_t bits = 0;
+        for (size_t b = s * 4; b < s * 4 + 4; b++) {
+            bits <<= 1;
+            if (b < decoder.inputSize()) {
+                bits |= (encoded[b / 8] >> (7 - b % 8)) & 1;
+            }
+        }
+        float i, q;
+        modulate(Modulation::Qam16, bits, i, q);
+        samples[s * 2] = i + noise(rng);
+        samples[s * 2 + 1] = q + noise(rng);
+    }
+    
+    SoftDemapper demapper(Modulation::Qam16, variance, 4.0f);
+    vector<int8_t> llr(symbolCount * 4);
+    demapper.demap(samples.data(), symbolCount, llr.data());
+    
+    size_t channelErrors = 0;
+    for (size_t b = 0; b < decoder.inputSize(); b++) {
+        if ((llr[b] < 0) != (((encoded[b / 8] >> (7 - b % 8)) & 1) == 1)) {
+            channelErrors++;
+        }
+    }
+    if (channelErrors == 0) {
+        // The test wouldn't prove anything
+        return false;
+    }
+    
+    vector<uint8_t> output(inputSize);
+    decoder.decode(llr.data(), output.data());
+    return output == input;
+}
+
+int main() {
+    mt19937 rng(time(0));
+    
+    cout << "Comparing to brute force max-log LLRs: ";
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(testAgainstReference(Modulation::Bpsk, rng));
+        assert(testAgainstReference(Modulation::Qpsk, rng));
+        assert(testAgainstReference(Modulation::Qam16, rng));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Decoding 16-QAM with noise: ";
+    for (uint32_t i = 0; i < 20; i++) {
+        assert(testTurbo16Qam(rng));
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
@@ -0,0 +1,145 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the fast path convolutional decoder of fecmagic. Clean blocks
+// must be decoded without the Viterbi decoder, and blocks with errors must be
+// decoded the same way as the Viterbi decoder does.
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/convolutional-decoder.h"
+#include "../src/fast-convolutional-decoder.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+template<typename TEncoder, typename TDecoder>
+bool testFastPath(size_t inputSize, uint32_t errorCount, uint64_t maxFallbackBlocks) {
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t encodedSize = TEncoder::calculateOutputSize(inputSize);
+    vector<uint8_t> encoded(encodedSize);
+    TEncoder encoder(encoded.data());
+    encoder.encode(input.data(), inputSize);
+    encoder.flush();
+    
+    // Flip bits far enough from each other that they can be corrected
+    size_t spacing = encodedSize * 8 / (errorCount + 1);
+    for (uint32_t i = 0; i < errorCount; i++) {
+        size_t pos = spacing * (i + 1) + rand() % 8;
+        encoded[pos / 8] ^= (1 << (7 - pos % 8));
+    }
+    
+    TDecoder decoder;
+    vector<uint8_t> output(TDecoder::calculateOutputSize(encodedSize));
+    decoder.decode(encoded.data(), encodedSize, output.data());
+    
+    const FastPathDecoderStatistics &stats = decoder.statistics();
+    if (stats.fallbackBlocks > maxFallbackBlocks || (errorCount == 0 && stats.viterbiSteps != 0)) {
+        return false;
+    }
+    
+    return 0 == memcmp(output.data(), input.data(), inputSize);
+}
+
+// Flips every received bit of the given step, which is near the end of a block
+template<typename TEncoder, typename TDecoder, typename TViterbiDecoder, uint32_t OutputCount>
+bool testErrorAtBlockEnd(size_t inputSize, size_t step) {
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t encodedSize = TEncoder::calculateOutputSize(inputSize);
+    vector<uint8_t> encoded(encodedSize);
+    TEncoder encoder(encoded.data());
+    encoder.encode(input.data(), inputSize);
+    encoder.flush();
+    
+    for (uint32_t o = 0; o < OutputCount; o++) {
+        size_t pos = step * OutputCount + o;
+        encoded[pos / 8] ^= (1 << (7 - pos % 8));
+    }
+    
+    TDecoder decoder;
+    vector<uint8_t> output(TDecoder::calculateOutputSize(encodedSize));
+    decoder.decode(encoded.data(), encodedSize, output.data());
+    
+    vector<uint8_t> expected(TViterbiDecoder::calculateOutputSize(encodedSize));
+    TViterbiDecoder viterbi(expected.data());
+    viterbi.decode(encoded.data(), encodedSize);
+    viterbi.flush();
+    
+    return 0 == memcmp(output.data(), expected.data(), inputSize) && 0 == memcmp(output.data(), input.data(), inputSize);
+}
+
+int main() {
+    srand(time(0));
+    
+    typedef ConvolutionalEncoder<7, uint8_t, 0x6d, 0x4f> Encoder7;
+    typedef FastPathConvolutionalDecoder<35, 7, uint8_t, 0x6d, 0x4f> Decoder7;
+    typedef ConvolutionalEncoder<3, uint8_t, 7, 3, 5> Encoder3;
+    typedef FastPathConvolutionalDecoder<15, 3, uint8_t, 7, 3, 5> Decoder3;
+    typedef ConvolutionalEncoder<7, uint8_t, 0x4f, 0x6d> EncoderSwapped;
+    typedef FastPathConvolutionalDecoder<35, 7, uint8_t, 0x4f, 0x6d> DecoderSwapped;
+    
+    cout << "Without errors: ";
+    for (uint32_t i = 0; i < 50; i++) {
+        assert((testFastPath<Encoder7, Decoder7>(1 + rand() % 1000, 0, 0)));
+        assert((testFastPath<Encoder3, Decoder3>(1 + rand() % 1000, 0, 0)));
+        assert((testFastPath<EncoderSwapped, DecoderSwapped>(1 + rand() % 1000, 0, 0)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "With errors: ";
+    for (uint32_t i = 0; i < 50; i++) {
+        // Each error affects at most a few blocks
+        assert((testFastPath<Encoder7, Decoder7>(500 + rand() % 1000, 5, 15)));
+        assert((testFastPath<Encoder3, Decoder3>(500 + rand() % 1000, 3, 9)));
+        assert((testFastPath<EncoderSwapped, DecoderSwapped>(500 + rand() % 1000, 5, 15)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Errors at the end of blocks: ";
+    for (size_t block = 1; block <= 4; block++) {
+        for (size_t back = 1; back < 7; back++) {
+            assert((testErrorAtBlockEnd<Encoder7, Decoder7, ConvolutionalDecoder<35, 7, uint8_t, 0x6d, 0x4f>, 2>(100, block * 64 - back)));
+        }
+        for (size_t back = 1; back < 3; back++) {
+            assert((testErrorAtBlockEnd<Encoder3, Decoder3, ConvolutionalDecoder<15, 3, uint8_t, 7, 3, 5>, 3>(100, block * 64 - back)));
+        }
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
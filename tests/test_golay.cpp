@@ -22,6 +22,8 @@
 // THE SOFTWARE.
 
 #include <iostream>
+#include <vector>
+#include <cstdlib>
 #include "../src/golay.h"
 
 using namespace std;
@@ -114,5 +116,60 @@ int main() {
     }
     cout << endl;
     
+    // Number of corrected bits, and four-bit errors, which must be detected
+    cout << "Testing the number of corrected bits and four-bit errors" << endl;
+    for (uint16_t i = 0; i <= 0xfff; i += 13) {
+        uint32_t coded = c.encode(i);
+        bool decodeSuccess;
+        unsigned correctedBits;
+        
+        uint32_t decoded = c.decode(coded, decodeSuccess, correctedBits);
+        assert(decodeSuccess && decoded == i && correctedBits == 0);
+        
+        for (unsigned n = 1; n <= 4; n++) {
+            BitmaskCombination<uint32_t, 4, 24> bmc(n);
+            for (uint32_t mask = bmc.next(); mask; mask = bmc.next()) {
+                decoded = c.decode(coded ^ mask, decodeSuccess, correctedBits);
+                if (n <= 3) {
+                    assert(decodeSuccess && decoded == i && correctedBits == n);
+                }
+                else {
+                    assert(!decodeSuccess);
+                }
+            }
+        }
+        cout << "\rSo far so good: " << i;
+    }
+    cout << endl;
+    
+    // Bit-sliced batch decoding, compared to decoding one codeword at a time
+    cout << "Testing batch decoding" << endl;
+    for (size_t count : { 0, 1, 8, 63, 64, 65, 1000 }) {
+        vector<uint32_t> input(count);
+        for (size_t i = 0; i < count; i++) {
+            // Up to 5 random errors
+            input[i] = c.encode(static_cast<uint16_t>(rand() & 0xfff));
+            unsigned errors = rand() % 6;
+            for (unsigned e = 0; e < errors; e++) {
+                input[i] ^= 1u << (rand() % 24);
+            }
+        }
+        
+        vector<uint16_t> output(count);
+        vector<uint8_t> status((count + 7) / 8, 0xff);
+        size_t failed = c.decodeBatch(input.data(), count, output.data(), status.data());
+        
+        size_t expectedFailed = 0;
+        for (size_t i = 0; i < count; i++) {
+            bool decodeSuccess;
+            uint16_t decoded = c.decode(input[i], decodeSuccess);
+            assert(output[i] == decoded);
+            assert(((status[i / 8] >> (7 - i % 8)) & 1) == !decodeSuccess);
+            expectedFailed += !decodeSuccess;
+        }
+        assert(failed == expectedFailed);
+    }
+    cout << "Batch decoding works." << endl;
+    
     return 0;
 }
@@ -22,6 +22,8 @@
 // THE SOFTWARE.
 
 #include <iostream>
+#include <cstdlib>
+#include <vector>
 #include "../src/hamming.h"
 
 using namespace std;
@@ -55,6 +57,46 @@ int main() {
         }
         
     }
+    
+    // Test the bulk APIs against encoding and decoding one codeword at a time
+    for (size_t size = 0; size <= 100; size++) {
+        vector<uint8_t> input(size);
+        for (size_t i = 0; i < size; i++) {
+            input[i] = static_cast<uint8_t>(rand());
+        }
+        
+        size_t codewordCount = HammingCode::calculateCodewordCount(size);
+        vector<uint8_t> encoded(codewordCount);
+        c.encodeNibbles(input.data(), size, encoded.data());
+        for (size_t i = 0; i < size; i++) {
+            assert(encoded[2 * i] == c.encode(input[i] >> 4));
+            assert(encoded[2 * i + 1] == c.encode(input[i] & 0x0f));
+        }
+        
+        // Flip a random bit in some of the codewords
+        size_t errors = 0;
+        for (size_t i = 0; i < codewordCount; i++) {
+            if (rand() % 3 == 0) {
+                encoded[i] ^= static_cast<uint8_t>(1 << (rand() % 7));
+                errors++;
+            }
+        }
+        
+        vector<uint8_t> decoded(size);
+        HammingDecodingSummary summary = c.decodeNibbles(encoded.data(), codewordCount, decoded.data());
+        assert(summary.codewords == codewordCount);
+        assert(summary.correctedCodewords == errors);
+        assert(decoded == input);
+        
+        // Odd number of codewords: the last one goes into a high nibble
+        if (size > 0) {
+            summary = c.decodeNibbles(encoded.data(), codewordCount - 1, decoded.data());
+            assert(summary.codewords == codewordCount - 1);
+            assert(decoded[size - 1] == (input[size - 1] & 0xf0));
+        }
+    }
+    
+    cout << "Bulk Hamming encoding and decoding works." << endl;
 
     return 0;
 }
@@ -0,0 +1,207 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the HARQ soft combining buffer of fecmagic: the saturating
+// additions, the hard decision export, and that frames which can't be decoded
+// from a single transmission are decoded after combining (with chase combining
+// and with incremental redundancy).
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/convolutional-decoder.h"
+#include "../src/outputsink.h"
+#include "../src/harq.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+constexpr uint8_t poly1 = 0x6d;
+constexpr uint8_t poly2 = 0x4f;
+
+typedef ConvolutionalEncoder<7, uint8_t, poly1, poly2> Encoder;
+typedef ConvolutionalDecoder<35, 7, uint16_t, poly1, poly2> Decoder;
+
+bool testAccumulate() {
+    size_t size = rand() % 1000;
+    HarqBuffer harq(size);
+    vector<int32_t> expected(size, 0);
+    vector<int8_t> input(size + 1);
+    
+    uint32_t transmissions = 1 + rand() % 5;
+    for (uint32_t t = 0; t < transmissions; t++) {
+        for (size_t i = 0; i < size; i++) {
+            input[i] = static_cast<int8_t>(rand() % 256 - 128);
+            expected[i] = max(-128, min(127, expected[i] + input[i]));
+        }
+        harq.combine(input.data());
+    }
+    
+    if (harq.transmissionCount() != transmissions) {
+        return false;
+    }
+    
+    vector<uint8_t> bits((size + 7) / 8 + 1), erasures((size + 7) / 8 + 1);
+    harq.hardDecision(bits.data(), erasures.data());
+    
+    for (size_t i = 0; i < size; i++) {
+        uint8_t bit = (bits[i / 8] >> (7 - i % 8)) & 1;
+        uint8_t erased = (erasures[i / 8] >> (7 - i % 8)) & 1;
+        if (harq.llr()[i] != expected[i] || bit != (expected[i] < 0 ? 1 : 0) || erased != (expected[i] == 0 ? 1 : 0)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Decodes the combined buffer with the hard decision Viterbi decoder
+bool decodeCombined(const HarqBuffer &harq, const vector<uint8_t> &input) {
+    vector<uint8_t> bits((harq.size() + 7) / 8), erasures((harq.size() + 7) / 8);
+    harq.hardDecision(bits.data(), erasures.data());
+    
+    vector<uint8_t> output(Decoder::calculateOutputSize(bits.size()));
+    BufferSink sink(output.data(), output.size());
+    Decoder decoder;
+    decoder.decodeBits(bits.data(), 0, harq.size(), erasures.data(), sink);
+    decoder.flushBits(sink);
+    
+    return 0 == memcmp(output.data(), input.data(), input.size());
+}
+
+// Encodes the input into LLRs
+vector<int8_t> encodeLlr(const vector<uint8_t> &input) {
+    vector<int8_t> llr(Encoder::calculateSymbolCount(input.size()));
+    Encoder encoder;
+    size_t count = encoder.encodeToSymbols<int8_t>(input.data(), input.size(), llr.data(), 40);
+    count += encoder.flushToSymbols<int8_t>(llr.data() + count, 40);
+    assert(count == llr.size());
+    return llr;
+}
+
+bool testChaseCombining() {
+    vector<uint8_t> input(100 + rand() % 200);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    vector<int8_t> llr = encodeLlr(input);
+    HarqBuffer harq(llr.size());
+    
+    // Each transmission has a burst of weakly wrong values at a different place,
+    // which is too long for the decoder to correct
+    size_t burst = 40;
+    for (uint32_t t = 0; t < 2; t++) {
+        vector<int8_t> received = llr;
+        size_t start = (t + 1) * llr.size() / 3;
+        for (size_t i = start; i < start + burst; i++) {
+            received[i] = static_cast<int8_t>(-received[i] / 4);
+        }
+        
+        HarqBuffer single(llr.size());
+        single.combine(received.data());
+        if (decodeCombined(single, input)) {
+            return false;
+        }
+        
+        harq.combine(received.data());
+    }
+    
+    return decodeCombined(harq, input);
+}
+
+bool testIncrementalRedundancy() {
+    vector<uint8_t> input(100 + rand() % 200);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    vector<int8_t> llr = encodeLlr(input);
+    HarqBuffer harq(llr.size());
+    
+    // The first transmission is rate 4/5, the second one has the rest of the bits
+    const uint8_t firstPattern[] = { 1, 1, 1, 0, 1, 0, 1, 0 };
+    const uint8_t secondPattern[] = { 0, 0, 0, 1, 0, 1, 0, 1 };
+    PuncturingStage first(firstPattern, 8);
+    PuncturingStage second(secondPattern, 8);
+    
+    for (const PuncturingStage *stage : { &first, &second }) {
+        const uint8_t *pattern = (stage == &first) ? firstPattern : secondPattern;
+        vector<int8_t> punctured;
+        for (size_t i = 0; i < llr.size(); i++) {
+            if (pattern[i % 8]) {
+                punctured.push_back(llr[i]);
+            }
+        }
+        
+        // Corrupt a few values that the first transmission can't correct on its own
+        for (size_t i = 0; i < punctured.size(); i += 25) {
+            punctured[i] = static_cast<int8_t>(-punctured[i] / 4);
+        }
+        
+        if (harq.combine(punctured.data(), *stage) != punctured.size()) {
+            return false;
+        }
+        
+        if (stage == &first) {
+            // Values that weren't sent are erased
+            vector<uint8_t> bits((harq.size() + 7) / 8), erasures((harq.size() + 7) / 8);
+            harq.hardDecision(bits.data(), erasures.data());
+            for (size_t i = 0; i < harq.size(); i++) {
+                if (((erasures[i / 8] >> (7 - i % 8)) & 1) != (firstPattern[i % 8] ^ 1)) {
+                    return false;
+                }
+            }
+        }
+    }
+    
+    return decodeCombined(harq, input);
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "Saturating combination and hard decisions: ";
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(testAccumulate());
+    }
+    cout << "OK" << endl;
+    
+    cout << "Chase combining: ";
+    for (uint32_t i = 0; i < 50; i++) {
+        assert(testChaseCombining());
+    }
+    cout << "OK" << endl;
+    
+    cout << "Incremental redundancy: ";
+    for (uint32_t i = 0; i < 50; i++) {
+        assert(testIncrementalRedundancy());
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
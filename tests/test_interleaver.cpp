@@ -0,0 +1,139 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include "../src/interleaver.h"
+
+using namespace std;
+using namespace fecmagic;
+
+bool testQpp() {
+    // LTE block size 40 uses f1=3, f2=10
+    QppInterleaver qpp(40, 3, 10);
+    
+    if (qpp.size() != 40 || !qpp.isValid()) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < 40; i++) {
+        if (qpp[i] != ((3 * i + 10 * i * i) % 40)) {
+            return false;
+        }
+    }
+    
+    // Largest LTE block size
+    QppInterleaver qpp2(6144, 263, 480);
+    return qpp2.isValid();
+}
+
+bool testSRandom() {
+    constexpr uint32_t size = 1024;
+    constexpr uint32_t spread = 12;
+    SRandomInterleaver s(size, spread, 1234);
+    
+    if (s.size() != size || !s.isValid()) {
+        return false;
+    }
+    
+    // Check the spread property
+    for (uint32_t i = 0; i < size; i++) {
+        for (uint32_t j = i + 1; j < size && j <= i + spread; j++) {
+            uint32_t d = (s[i] > s[j]) ? (s[i] - s[j]) : (s[j] - s[i]);
+            if (d <= spread) {
+                return false;
+            }
+        }
+    }
+    
+    // The same seed gives the same permutation
+    SRandomInterleaver s2(size, spread, 1234);
+    if (0 != memcmp(s.permutation(), s2.permutation(), size * sizeof(uint32_t))) {
+        return false;
+    }
+    
+    // An impossible spread is rejected
+    bool thrown = false;
+    try {
+        SRandomInterleaver s3(64, 40, 0, 3);
+    }
+    catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    
+    return thrown;
+}
+
+bool testInterleaveDeinterleave() {
+    QppInterleaver qpp(64, 9, 16);
+    assert(qpp.isValid());
+    
+    // Values
+    vector<int16_t> values(64), interleaved(64), deinterleaved(64);
+    for (uint32_t i = 0; i < 64; i++) {
+        values[i] = rand() % 1000;
+    }
+    qpp.interleave(values.data(), interleaved.data());
+    qpp.deinterleave(interleaved.data(), deinterleaved.data());
+    if (values != deinterleaved) {
+        return false;
+    }
+    
+    // Bits must be interleaved the same way as values
+    uint8_t bits[8], interleavedBits[8], deinterleavedBits[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        bits[i] = rand() % 256;
+    }
+    qpp.interleaveBits(bits, interleavedBits);
+    for (uint32_t i = 0; i < 64; i++) {
+        uint8_t expected = (bits[qpp[i] / 8] >> (7 - qpp[i] % 8)) & 1;
+        uint8_t actual = (interleavedBits[i / 8] >> (7 - i % 8)) & 1;
+        if (expected != actual) {
+            return false;
+        }
+    }
+    qpp.deinterleaveBits(interleavedBits, deinterleavedBits);
+    
+    return 0 == memcmp(bits, deinterleavedBits, 8);
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "QPP interleaver: ";
+    assert(testQpp());
+    cout << "OK" << endl;
+    
+    cout << "S-random interleaver: ";
+    assert(testSRandom());
+    cout << "OK" << endl;
+    
+    cout << "Interleave and deinterleave: ";
+    assert(testInterleaveDeinterleave());
+    cout << "OK" << endl;
+    
+    return 0;
+}
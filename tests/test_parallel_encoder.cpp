@@ -0,0 +1,132 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the parallel encoder of fecmagic. Its output is compared to
+// the output of a single encoder.
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/parallel-encoder.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+template<typename TEncoder>
+bool testResetAt() {
+    // Encode in two parts with two encoders, the second one starting at a random offset
+    size_t inputSize = 2 + rand() % 200;
+    size_t offset = 1 + rand() % (inputSize - 1);
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t outputSize = TEncoder::calculateOutputSize(inputSize);
+    vector<uint8_t> expected(outputSize), output(outputSize);
+    
+    TEncoder encoder;
+    encoder.reset(expected.data());
+    encoder.encode(input.data(), inputSize);
+    encoder.flush();
+    
+    TEncoder first, second;
+    first.reset(output.data());
+    first.encode(input.data(), offset);
+    second.resetAt(output.data(), input.data(), offset);
+    second.encode(input.data() + offset, inputSize - offset);
+    second.flush();
+    
+    return output == expected;
+}
+
+template<typename TEncoder>
+bool testParallel(ParallelEncoder<TEncoder> &parallelEncoder, size_t inputSize) {
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t outputSize = TEncoder::calculateOutputSize(inputSize);
+    vector<uint8_t> expected(outputSize), output(outputSize);
+    
+    TEncoder encoder;
+    encoder.reset(expected.data());
+    encoder.encode(input.data(), inputSize);
+    encoder.flush();
+    
+    parallelEncoder.encode(input.data(), inputSize, output.data());
+    
+    return output == expected;
+}
+
+template<typename TEncoder>
+void testCode() {
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(testResetAt<TEncoder>());
+    }
+    
+    for (uint32_t threads = 1; threads <= 5; threads += 2) {
+        // Small chunks, so that there are many of them
+        ParallelEncoder<TEncoder> parallelEncoder(threads, 100);
+        assert(parallelEncoder.threadCount() == threads);
+        for (uint32_t i = 0; i < 20; i++) {
+            assert(testParallel(parallelEncoder, rand() % 5000));
+        }
+        assert(testParallel(parallelEncoder, 0));
+        assert(testParallel(parallelEncoder, 1));
+    }
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "K=7, rate 1/2: ";
+    testCode<ConvolutionalEncoder<7, uint8_t, 0x6d, 0x4f>>();
+    cout << "OK" << endl;
+    
+    cout << "K=3, rate 1/3: ";
+    testCode<ConvolutionalEncoder<3, uint8_t, 7, 3, 5>>();
+    cout << "OK" << endl;
+    
+    cout << "K=7, punctured to rate 2/3: ";
+    testCode<PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1>, 7, uint8_t, 0x6d, 0x4f>>();
+    cout << "OK" << endl;
+    
+    cout << "K=9, rate 1/3, punctured: ";
+    testCode<PuncturedConvolutionalEncoder<Sequence<uint8_t, 1, 1, 0, 1, 1>, 9, uint16_t, 0x1af, 0x11d, 0x1ed>>();
+    cout << "OK" << endl;
+    
+    cout << "Large input: ";
+    ParallelEncoder<ConvolutionalEncoder<7, uint8_t, 0x6d, 0x4f>> parallelEncoder(4);
+    assert(testParallel(parallelEncoder, 3 * 1024 * 1024 + 17));
+    cout << "OK" << endl;
+    
+    return 0;
+}
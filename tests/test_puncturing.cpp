@@ -0,0 +1,184 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the puncturing stage of fecmagic. Puncturing and depuncturing
+// are compared to a simple bit-by-bit implementation, and depunctured streams
+// are decoded by the convolutional decoder using the erasure bitmap.
+
+#include "helper.h"
+#include "../src/puncturing.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/convolutional-decoder.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+bool testPuncture(const vector<uint8_t> &pattern) {
+    PuncturingStage stage(pattern.data(), pattern.size());
+    
+    size_t bitCount = rand() % 2000;
+    vector<uint8_t> input(bitCount / 8 + 1);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    vector<uint8_t> inputBits(input.size() * 8);
+    bytearray2zeroone(input.size(), input.data(), inputBits.data());
+    
+    // Puncture bit by bit, starting at a random phase
+    size_t startPhase = rand() % pattern.size();
+    vector<uint8_t> expectedBits;
+    for (size_t i = 0; i < bitCount; i++) {
+        if (pattern[(startPhase + i) % pattern.size()]) {
+            expectedBits.push_back(inputBits[i]);
+        }
+    }
+    if (stage.puncturedBitCount(bitCount, startPhase) != expectedBits.size()) {
+        return false;
+    }
+    
+    // Puncture in two parts, after a few bits that must be kept
+    size_t offset = rand() % 8;
+    size_t firstPart = rand() % (bitCount + 1);
+    firstPart -= firstPart % 8;
+    vector<uint8_t> output(expectedBits.size() / 8 + 2, 0);
+    output[0] = 0xff;
+    size_t phase = startPhase;
+    size_t written = stage.puncture(input.data(), firstPart, output.data(), offset, phase);
+    written += stage.puncture(input.data() + firstPart / 8, bitCount - firstPart, output.data(), offset + written, phase);
+    if (written != expectedBits.size() || phase != (startPhase + bitCount) % pattern.size()) {
+        return false;
+    }
+    
+    vector<uint8_t> outputBits(output.size() * 8);
+    bytearray2zeroone(output.size(), output.data(), outputBits.data());
+    for (size_t i = 0; i < offset; i++) {
+        if (outputBits[i] != 1) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < written; i++) {
+        if (outputBits[offset + i] != expectedBits[i]) {
+            return false;
+        }
+    }
+    
+    // Depuncture
+    vector<uint8_t> depunctured(input.size()), erasures(input.size());
+    phase = startPhase;
+    size_t consumed = stage.depuncture(output.data(), offset, depunctured.data(), erasures.data(), bitCount, phase);
+    if (consumed != written || phase != (startPhase + bitCount) % pattern.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < bitCount; i++) {
+        uint8_t bit = (depunctured[i / 8] >> (7 - i % 8)) & 1;
+        uint8_t erased = (erasures[i / 8] >> (7 - i % 8)) & 1;
+        bool kept = pattern[(startPhase + i) % pattern.size()] != 0;
+        if (erased != (kept ? 0 : 1) || bit != (kept ? inputBits[i] : 0)) {
+            return false;
+        }
+    }
+    
+    // Depuncture soft values
+    vector<int8_t> soft(written + 1), softOutput(bitCount + 1);
+    for (size_t i = 0; i < written; i++) {
+        soft[i] = expectedBits[i] ? -1 : 1;
+    }
+    phase = startPhase;
+    if (stage.depunctureSoft(soft.data(), softOutput.data(), bitCount, phase) != written) {
+        return false;
+    }
+    for (size_t i = 0; i < bitCount; i++) {
+        bool kept = pattern[(startPhase + i) % pattern.size()] != 0;
+        if (softOutput[i] != (kept ? (inputBits[i] ? -1 : 1) : 0)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool testDecodeDepunctured(const char *input) {
+    // Puncture the output of a rate 1/2 code to rate 2/3, then depuncture and decode it
+    // with the unpunctured decoder, which ignores the erased bits
+    size_t inputSize = strlen(input) + 1;
+    const uint8_t pattern[] = { 1, 1, 0, 1 };
+    PuncturingStage stage(pattern, 4);
+    
+    ConvolutionalEncoder<7, uint8_t, 0x6d, 0x4f> encoder;
+    size_t encodedSize = decltype(encoder)::calculateOutputSize(inputSize);
+    vector<uint8_t> encoded(encodedSize);
+    encoder.reset(encoded.data());
+    encoder.encode(input, inputSize);
+    encoder.flush();
+    
+    vector<uint8_t> punctured(encodedSize);
+    size_t phase = 0;
+    size_t puncturedBits = stage.puncture(encoded.data(), encodedSize * 8, punctured.data(), 0, phase);
+    
+    vector<uint8_t> depunctured(encodedSize), erasures(encodedSize);
+    phase = 0;
+    if (stage.depuncture(punctured.data(), 0, depunctured.data(), erasures.data(), encodedSize * 8, phase) != puncturedBits) {
+        return false;
+    }
+    
+    typedef ConvolutionalDecoder<35, 7, uint8_t, 0x6d, 0x4f> Decoder;
+    vector<uint8_t> decoded(Decoder::calculateOutputSize(encodedSize));
+    Decoder decoder(decoded.data());
+    decoder.decode(depunctured.data(), encodedSize, erasures.data());
+    decoder.flush();
+    
+    return 0 == memcmp(decoded.data(), input, inputSize);
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "Puncturing: ";
+    for (uint32_t i = 0; i < 200; i++) {
+        assert(testPuncture({ 1 }));
+        assert(testPuncture({ 1, 1, 0, 1 }));
+        assert(testPuncture({ 1, 1, 1, 0, 0, 1 }));
+        assert(testPuncture({ 1, 0, 1, 1, 0, 1, 1 }));
+        vector<uint8_t> pattern(1 + rand() % 100);
+        for (auto &p : pattern) {
+            p = rand() % 2;
+        }
+        pattern[rand() % pattern.size()] = 1;
+        assert(testPuncture(pattern));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Decoding depunctured stream: ";
+    assert(testDecodeDepunctured("Hello, world!"));
+    assert(testDecodeDepunctured("Good morning, Captain! Are we awesome yet?"));
+    cout << "OK" << endl;
+    
+    return 0;
+}
@@ -0,0 +1,146 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the rate-compatible punctured convolutional codes of fecmagic.
+// Frames are encoded and decoded with a different rate each, with one encoder
+// and one decoder, and the output is compared to the compile-time punctured encoder.
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/rate-compatible-puncturing.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+constexpr uint8_t poly1 = 0x6d;
+constexpr uint8_t poly2 = 0x4f;
+
+// Nested patterns with rates 1/2, 4/7, 2/3 and 4/5
+const uint8_t patterns[] = {
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 0,
+    1, 1, 1, 0, 1, 1, 1, 0,
+    1, 1, 1, 0, 1, 0, 1, 0,
+};
+
+typedef RateCompatibleConvolutionalEncoder<7, uint8_t, poly1, poly2> Encoder;
+typedef RateCompatibleConvolutionalDecoder<35, 7, uint16_t, poly1, poly2> Decoder;
+
+// Checks that the output is the same as that of an encoder with the pattern as its puncturing matrix
+template<typename TPuncturingMatrix>
+bool testSameAsPunctured(Encoder &encoder, size_t rateIndex) {
+    typedef PuncturedConvolutionalEncoder<TPuncturingMatrix, 7, uint8_t, poly1, poly2> PuncturedEncoder;
+    
+    size_t inputSize = 1 + rand() % 300;
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    vector<uint8_t> expected(PuncturedEncoder::calculateOutputSize(inputSize), 0);
+    PuncturedEncoder puncturedEncoder(expected.data());
+    puncturedEncoder.encode(input.data(), inputSize);
+    puncturedEncoder.flush();
+    
+    vector<uint8_t> output(encoder.calculateOutputSize(inputSize, rateIndex), 0);
+    size_t bits = encoder.encodeFrame(input.data(), inputSize, rateIndex, output.data());
+    
+    return bits == PuncturedEncoder::calculateSymbolCount(inputSize) && output == expected;
+}
+
+bool testFrame(Encoder &encoder, Decoder &decoder, size_t rateIndex, uint32_t errorCount) {
+    size_t inputSize = 100 + rand() % 300;
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t symbolCount = encoder.calculateSymbolCount(inputSize, rateIndex);
+    vector<uint8_t> encoded(encoder.calculateOutputSize(inputSize, rateIndex));
+    if (encoder.encodeFrame(input.data(), inputSize, rateIndex, encoded.data()) != symbolCount) {
+        return false;
+    }
+    if (decoder.calculateSymbolCount(inputSize, rateIndex) != symbolCount) {
+        return false;
+    }
+    
+    // Flip bits far enough from each other that they can be corrected
+    size_t spacing = symbolCount / (errorCount + 1);
+    for (uint32_t i = 0; i < errorCount; i++) {
+        size_t pos = spacing * (i + 1);
+        encoded[pos / 8] ^= (1 << (7 - pos % 8));
+    }
+    
+    vector<uint8_t> output(inputSize);
+    decoder.decodeFrame(encoded.data(), inputSize, rateIndex, output.data());
+    
+    return output == input;
+}
+
+int main() {
+    srand(time(0));
+    
+    RateCompatiblePuncturingFamily family(patterns, 4, 8);
+    assert(family.size() == 4);
+    assert(family.period() == 8);
+    assert(RateCompatiblePuncturingFamily::isNested(patterns, 4, 8));
+    
+    const uint8_t notNested[] = {
+        1, 1, 1, 0,
+        1, 1, 0, 1,
+    };
+    assert(!RateCompatiblePuncturingFamily::isNested(notNested, 2, 4));
+    
+    Encoder encoder(family);
+    Decoder decoder(family);
+    
+    cout << "Same output as the punctured encoder: ";
+    for (uint32_t i = 0; i < 20; i++) {
+        assert((testSameAsPunctured<Sequence<uint8_t, 1, 1, 1, 1, 1, 1, 1, 1>>(encoder, 0)));
+        assert((testSameAsPunctured<Sequence<uint8_t, 1, 1, 1, 1, 1, 1, 1, 0>>(encoder, 1)));
+        assert((testSameAsPunctured<Sequence<uint8_t, 1, 1, 1, 0, 1, 1, 1, 0>>(encoder, 2)));
+        assert((testSameAsPunctured<Sequence<uint8_t, 1, 1, 1, 0, 1, 0, 1, 0>>(encoder, 3)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Switching rates per frame: ";
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(testFrame(encoder, decoder, rand() % family.size(), 0));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Switching rates per frame, with errors: ";
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(testFrame(encoder, decoder, rand() % 2, 3));
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
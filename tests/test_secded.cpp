@@ -0,0 +1,234 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the SECDED Hamming(72, 64) code of fecmagic and its buffer scrubber.
+// Every single bit error must be corrected and every double bit error detected.
+
+#include "helper.h"
+#include "../src/secded.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+using namespace fecmagic;
+
+uint64_t randomWord() {
+    uint64_t w = 0;
+    for (unsigned i = 0; i < 4; i++) {
+        w = (w << 16) | (rand() & 0xffff);
+    }
+    return w;
+}
+
+// Flips the given bit of a codeword: 0-63 are in the word, 64-71 in the check byte
+void flipBit(uint64_t &word, uint8_t &check, unsigned position) {
+    if (position < 64) {
+        word ^= static_cast<uint64_t>(1) << position;
+    }
+    else {
+        check ^= static_cast<uint8_t>(1 << (position - 64));
+    }
+}
+
+void testSingleWords() {
+    SecdedCode code;
+    
+    for (unsigned n = 0; n < 100; n++) {
+        uint64_t original = randomWord();
+        uint8_t originalCheck = code.encode(original);
+        
+        uint64_t word = original;
+        uint8_t check = originalCheck;
+        assert(code.correct(word, check) == SecdedResult::NoError);
+        assert(word == original && check == originalCheck);
+        
+        for (unsigned i = 0; i < 72; i++) {
+            word = original;
+            check = originalCheck;
+            flipBit(word, check, i);
+            assert(code.correct(word, check) == SecdedResult::Corrected);
+            assert(word == original && check == originalCheck);
+            
+            for (unsigned j = i + 1; j < 72; j++) {
+                word = original;
+                check = originalCheck;
+                flipBit(word, check, i);
+                flipBit(word, check, j);
+                uint64_t corrupted = word;
+                uint8_t corruptedCheck = check;
+                assert(code.correct(word, check) == SecdedResult::Uncorrectable);
+                assert(word == corrupted && check == corruptedCheck);
+            }
+        }
+    }
+}
+
+void testBuffer(size_t count) {
+    SecdedCode code;
+    vector<uint64_t> original(count);
+    vector<uint8_t> originalChecks(count);
+    for (auto &w : original) {
+        w = randomWord();
+    }
+    
+    code.encodeBuffer(original.data(), count, originalChecks.data());
+    for (size_t i = 0; i < count; i++) {
+        assert(originalChecks[i] == code.encode(original[i]));
+    }
+    
+    // Corrupt some words with single and some with double bit errors
+    vector<uint64_t> words = original;
+    vector<uint8_t> checks = originalChecks;
+    vector<uint8_t> expectedStatus((count + 7) / 8, 0);
+    size_t expectedCorrected = 0, expectedUncorrectable = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned r = rand() % 8;
+        if (r == 0) {
+            flipBit(words[i], checks[i], rand() % 72);
+            expectedCorrected++;
+        }
+        else if (r == 1) {
+            unsigned a = rand() % 72;
+            unsigned b = (a + 1 + rand() % 71) % 72;
+            flipBit(words[i], checks[i], a);
+            flipBit(words[i], checks[i], b);
+            expectedUncorrectable++;
+            expectedStatus[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+    vector<uint64_t> corrupted = words;
+    vector<uint8_t> corruptedChecks = checks;
+    
+    vector<uint8_t> status((count + 7) / 8, 0xff);
+    SecdedSummary summary = code.correctBuffer(words.data(), checks.data(), count, status.data());
+    assert(summary.corrected == expectedCorrected);
+    assert(summary.uncorrectable == expectedUncorrectable);
+    assert(status == expectedStatus);
+    
+    for (size_t i = 0; i < count; i++) {
+        if (expectedStatus[i / 8] & (0x80 >> (i % 8))) {
+            assert(words[i] == corrupted[i] && checks[i] == corruptedChecks[i]);
+        }
+        else {
+            assert(words[i] == original[i] && checks[i] == originalChecks[i]);
+        }
+    }
+    
+    // Nothing is left to correct
+    summary = code.correctBuffer(words.data(), checks.data(), count);
+    assert(summary.corrected == 0);
+    assert(summary.uncorrectable == expectedUncorrectable);
+}
+
+void testScrubber() {
+    SecdedCode code;
+    size_t count = 10000;
+    vector<uint64_t> original(count);
+    for (auto &w : original) {
+        w = randomWord();
+    }
+    vector<uint8_t> checks(count);
+    code.encodeBuffer(original.data(), count, checks.data());
+    
+    vector<uint64_t> words = original;
+    words[10] ^= 1;
+    words[5000] ^= static_cast<uint64_t>(1) << 63;
+    checks[9999] ^= 0x10;
+    words[1234] ^= 0x3;
+    
+    mutex reportedMutex;
+    vector<size_t> reported;
+    {
+        SecdedScrubber scrubber(words.data(), checks.data(), count, 1e9, [&](size_t index) {
+            lock_guard<mutex> lock(reportedMutex);
+            reported.push_back(index);
+        });
+        while (scrubber.passCount() < 1) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        assert(scrubber.correctedCount() == 3);
+        assert(scrubber.uncorrectableCount() >= 1);
+        
+        // Rewrite the broken word while scrubbing is paused
+        {
+            lock_guard<SecdedScrubber> lock(scrubber);
+            words[1234] = original[1234];
+            checks[1234] = code.encode(words[1234]);
+        }
+    }
+    
+    assert(words == original);
+    assert(!reported.empty());
+    for (size_t index : reported) {
+        assert(index == 1234);
+    }
+    
+    // A slow scrubber doesn't finish a pass over 900 KB in a short time
+    count = 100000;
+    words.assign(count, 0);
+    checks.assign(count, 0);
+    {
+        SecdedScrubber scrubber(words.data(), checks.data(), count, 1e6);
+        this_thread::sleep_for(chrono::milliseconds(100));
+        assert(scrubber.passCount() == 0);
+        
+        // Speeding it up makes it finish
+        scrubber.setBandwidth(1e10);
+        while (scrubber.passCount() < 1) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    
+    // An empty buffer can be stopped
+    {
+        SecdedScrubber scrubber(nullptr, nullptr, 0, 1e6);
+    }
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "Single words: ";
+    testSingleWords();
+    cout << "OK" << endl;
+    
+    cout << "Buffers: ";
+    for (size_t count = 0; count < 70; count++) {
+        testBuffer(count);
+    }
+    testBuffer(100000 + rand() % 100);
+    cout << "OK" << endl;
+    
+    cout << "Scrubber: ";
+    testScrubber();
+    cout << "OK" << endl;
+    
+    return 0;
+}
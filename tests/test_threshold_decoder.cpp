@@ -0,0 +1,122 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the majority-logic (threshold) decoder of fecmagic. It encodes
+// random data with self-orthogonal systematic codes, introduces errors that are
+// within the error correction capability of the decoder, and checks the output.
+
+#include "helper.h"
+#include "../src/convolutional-encoder.h"
+#include "../src/threshold-decoder.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+// Introduces errorsPerGroup errors within each window of the given span, the windows are far enough
+// from each other that the decoder can correct the errors of each of them independently.
+void introduceErrors(vector<uint8_t> &encoded, size_t span, uint32_t errorsPerGroup) {
+    size_t bitCount = encoded.size() * 8;
+    for (size_t start = rand() % span; start + span < bitCount; start += 3 * span) {
+        for (uint32_t i = 0; i < errorsPerGroup; i++) {
+            size_t pos = start + rand() % span;
+            encoded[pos / 8] ^= (1 << (7 - pos % 8));
+        }
+    }
+}
+
+template<typename TEncoder, typename TDecoder, uint32_t ConstraintLength, uint32_t OutputCount>
+bool testThreshold(size_t inputSize, uint32_t errorsPerGroup, size_t chunkSize) {
+    vector<uint8_t> input(inputSize);
+    for (auto &b : input) {
+        b = rand() % 256;
+    }
+    
+    size_t encodedSize = TEncoder::calculateOutputSize(inputSize);
+    vector<uint8_t> encoded(encodedSize);
+    TEncoder encoder(encoded.data());
+    encoder.encode(input.data(), inputSize);
+    encoder.flush();
+    
+    // Distinct errors must be in different windows of ConstraintLength steps
+    introduceErrors(encoded, ConstraintLength * OutputCount, errorsPerGroup);
+    
+    vector<uint8_t> output(TDecoder::calculateOutputSize(encodedSize));
+    TDecoder decoder(output.data());
+    for (size_t pos = 0; pos < encodedSize; pos += chunkSize) {
+        decoder.decode(encoded.data() + pos, min(chunkSize, encodedSize - pos));
+    }
+    decoder.flush();
+    
+    return 0 == memcmp(output.data(), input.data(), inputSize);
+}
+
+int main() {
+    srand(time(0));
+    
+    // Self-orthogonal code with J = 4 (taps at delays 0, 1, 4, 6)
+    typedef ConvolutionalEncoder<7, uint8_t, 0x40, 0x65> Encoder7;
+    typedef ThresholdConvolutionalDecoder<7, uint8_t, 0x40, 0x65> Decoder7;
+    
+    // Self-orthogonal code with J = 6 (taps at delays 0, 2, 7, 13, 16, 17)
+    typedef ConvolutionalEncoder<18, uint32_t, 0x20000, 0x28413> Encoder18;
+    typedef ThresholdConvolutionalDecoder<18, uint32_t, 0x20000, 0x28413> Decoder18;
+    
+    // Rate 1/3 code, with the systematic output in the middle and J = 4
+    typedef ConvolutionalEncoder<3, uint8_t, 6, 4, 5> Encoder3;
+    typedef ThresholdConvolutionalDecoder<3, uint8_t, 6, 4, 5> Decoder3;
+    
+    assert(Decoder7::isSelfOrthogonal());
+    assert(Decoder18::isSelfOrthogonal());
+    assert(Decoder3::isSelfOrthogonal());
+    assert((!ThresholdConvolutionalDecoder<7, uint8_t, 0x40, 0x6d>::isSelfOrthogonal()));
+    assert((!ThresholdConvolutionalDecoder<3, uint8_t, 4, 6, 7>::isSelfOrthogonal()));
+    
+    Decoder18 d18;
+    assert(d18.checkCount() == 6);
+    assert(Decoder7::decodingDelay() == 6);
+    
+    cout << "Without errors: ";
+    for (uint32_t i = 0; i < 100; i++) {
+        assert((testThreshold<Encoder7, Decoder7, 7, 2>(1 + rand() % 1000, 0, 1 + rand() % 100)));
+        assert((testThreshold<Encoder18, Decoder18, 18, 2>(1 + rand() % 1000, 0, 1 + rand() % 100)));
+        assert((testThreshold<Encoder3, Decoder3, 3, 3>(1 + rand() % 1000, 0, 1 + rand() % 100)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "With errors: ";
+    for (uint32_t i = 0; i < 100; i++) {
+        assert((testThreshold<Encoder7, Decoder7, 7, 2>(1 + rand() % 1000, 2, 1 + rand() % 100)));
+        assert((testThreshold<Encoder18, Decoder18, 18, 2>(1 + rand() % 1000, 3, 1 + rand() % 100)));
+        assert((testThreshold<Encoder3, Decoder3, 3, 3>(1 + rand() % 1000, 2, 1 + rand() % 100)));
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}
@@ -0,0 +1,177 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the turbo decoder of fecmagic. Blocks are encoded by the turbo
+// encoder, transmitted over a simulated BPSK channel with or without noise, and
+// then decoded.
+
+#include "helper.h"
+#include "../src/turbo-encoder.h"
+#include "../src/turbo-decoder.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+using namespace std;
+using namespace fecmagic;
+
+// Converts the encoded bits to LLRs, optionally with added white gaussian noise.
+// Returns the number of hard decision errors in the channel.
+template<typename TEncoder>
+size_t transmit(const vector<uint8_t> &encoded, size_t bitCount, double ebN0, mt19937 &rng, vector<int8_t> &llr) {
+    llr.resize(bitCount);
+    size_t errors = 0;
+    
+    if (ebN0 < 0.0) {
+        // No noise
+        for (size_t i = 0; i < bitCount; i++) {
+            uint8_t bit = (encoded[i / 8] >> (7 - i % 8)) & 1;
+            llr[i] = bit ? -64 : 64;
+        }
+        return 0;
+    }
+    
+    // The code rate is 1/3
+    double esN0 = pow(10.0, ebN0 / 10.0) / 3.0;
+    double variance = 1.0 / (2.0 * esN0);
+    normal_distribution<double> noise(0.0, sqrt(variance));
+    
+    for (size_t i = 0; i < bitCount; i++) {
+        uint8_t bit = (encoded[i / 8] >> (7 - i % 8)) & 1;
+        double y = (bit ? -1.0 : 1.0) + noise(rng);
+        if ((y < 0.0) != (bit == 1)) {
+            errors++;
+        }
+        double l = round(2.0 * y / variance * 8.0);
+        llr[i] = static_cast<int8_t>(max(min(l, 127.0), -127.0));
+    }
+    return errors;
+}
+
+template<typename TEncoder, typename TDecoder>
+bool testDecode(const Interleaver &interleaver, double ebN0, uint32_t maxExpectedIterations, mt19937 &rng) {
+    TEncoder encoder(interleaver);
+    TDecoder decoder(interleaver, 8);
+    size_t inputSize = encoder.blockSize();
+    assert(decoder.blockSize() == inputSize);
+    
+    vector<uint8_t> input(inputSize);
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rng() % 256;
+    }
+    
+    vector<uint8_t> encoded(TEncoder::calculateOutputSize(inputSize));
+    encoder.encode(input.data(), encoded.data());
+    
+    vector<int8_t> llr;
+    size_t channelErrors = transmit<TEncoder>(encoded, decoder.inputSize(), ebN0, rng, llr);
+    if (ebN0 >= 0.0 && channelErrors == 0) {
+        // The test wouldn't prove anything
+        return false;
+    }
+    
+    vector<uint8_t> output(inputSize);
+    uint32_t iterations = decoder.decode(llr.data(), output.data());
+    
+    return output == input && iterations <= maxExpectedIterations;
+}
+
+bool testBlockCheck(mt19937 &rng) {
+    QppInterleaver interleaver(1024, 31, 64);
+    LteTurboEncoder encoder(interleaver);
+    LteTurboDecoder<> decoder(interleaver, 8);
+    size_t inputSize = encoder.blockSize();
+    
+    vector<uint8_t> input(inputSize);
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rng() % 256;
+    }
+    vector<uint8_t> encoded(LteTurboEncoder::calculateOutputSize(inputSize));
+    encoder.encode(input.data(), encoded.data());
+    
+    vector<int8_t> llr;
+    transmit<LteTurboEncoder>(encoded, decoder.inputSize(), -1.0, rng, llr);
+    
+    // A check that never passes: all iterations are done
+    vector<uint8_t> output(inputSize);
+    decoder.setStopOnAgreement(false);
+    decoder.setBlockCheck([](const uint8_t *, size_t) { return false; });
+    if (decoder.decode(llr.data(), output.data()) != 8 || output != input) {
+        return false;
+    }
+    
+    // A check that passes for the correct block
+    decoder.setBlockCheck([&input](const uint8_t *decoded, size_t size) {
+        return size == input.size() && equal(input.begin(), input.end(), decoded);
+    });
+    if (decoder.decode(llr.data(), output.data()) != 1 || output != input) {
+        return false;
+    }
+    
+    return true;
+}
+
+int main() {
+    mt19937 rng(42);
+    
+    QppInterleaver lte40(40, 3, 10);
+    QppInterleaver lte1024(1024, 31, 64);
+    QppInterleaver lte6144(6144, 263, 480);
+    SRandomInterleaver srandom1024(1024, 12, 7);
+    
+    cout << "Turbo decoder without noise: ";
+    assert((testDecode<LteTurboEncoder, LteTurboDecoder<>>(lte40, -1.0, 1, rng)));
+    assert((testDecode<LteTurboEncoder, LteTurboDecoder<>>(lte1024, -1.0, 1, rng)));
+    assert((testDecode<LteTurboEncoder, LteTurboDecoder<>>(lte6144, -1.0, 1, rng)));
+    assert((testDecode<LteTurboEncoder, LteTurboDecoder<16>>(srandom1024, -1.0, 1, rng)));
+    cout << "OK" << endl;
+    
+    cout << "Turbo decoder with noise: ";
+    for (uint32_t i = 0; i < 10; i++) {
+        assert((testDecode<LteTurboEncoder, LteTurboDecoder<>>(lte1024, 2.0, 8, rng)));
+        assert((testDecode<LteTurboEncoder, LteTurboDecoder<>>(lte6144, 1.5, 8, rng)));
+        assert((testDecode<LteTurboEncoder, LteTurboDecoder<64>>(srandom1024, 2.0, 8, rng)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Turbo decoder with 4-state code: ";
+    typedef TurboEncoder<3, uint8_t, 0x7, 0x5> Encoder4;
+    typedef TurboDecoder<32, 3, uint8_t, 0x7, 0x5> Decoder4;
+    assert((testDecode<Encoder4, Decoder4>(lte1024, -1.0, 1, rng)));
+    for (uint32_t i = 0; i < 10; i++) {
+        assert((testDecode<Encoder4, Decoder4>(lte1024, 3.0, 8, rng)));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Turbo decoder block check: ";
+    assert(testBlockCheck(rng));
+    cout << "OK" << endl;
+    
+    return 0;
+}
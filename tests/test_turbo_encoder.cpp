@@ -0,0 +1,172 @@
+
+// This file is part of fecmagic, the forward error correction library.
+// Copyright (c) 2016 Timur Kristóf
+// Licensed to you under the terms of the MIT license.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// README
+// ======
+//
+// This file tests the RSC encoder and the turbo encoder of fecmagic. The table-driven
+// encoders are compared to a simple bit-by-bit implementation.
+
+#include "helper.h"
+#include "../src/recursive-convolutional-encoder.h"
+#include "../src/turbo-encoder.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fecmagic;
+
+// Bit-by-bit RSC encoder, for the LTE constituent code:
+// feedback 1 + D^2 + D^3, feed-forward 1 + D + D^3
+struct ReferenceRsc {
+    uint8_t s1 = 0, s2 = 0, s3 = 0;
+    
+    uint8_t encode(uint8_t in) {
+        uint8_t a = in ^ s2 ^ s3;
+        uint8_t p = a ^ s1 ^ s3;
+        s3 = s2;
+        s2 = s1;
+        s1 = a;
+        return p;
+    }
+    
+    uint8_t terminationBit() const {
+        return s2 ^ s3;
+    }
+};
+
+bool testRsc(size_t inputSize) {
+    typedef RecursiveSystematicConvolutionalEncoder<4, uint8_t, 0xb, 0xd> Rsc;
+    
+    vector<uint8_t> input(inputSize);
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rand() % 256;
+    }
+    
+    // Reference output, in zeroes and ones
+    vector<uint8_t> expectedBits;
+    ReferenceRsc ref;
+    for (size_t i = 0; i < inputSize * 8; i++) {
+        uint8_t in = (input[i / 8] >> (7 - i % 8)) & 1;
+        expectedBits.push_back(in);
+        expectedBits.push_back(ref.encode(in));
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        uint8_t in = ref.terminationBit();
+        expectedBits.push_back(in);
+        expectedBits.push_back(ref.encode(in));
+    }
+    if (ref.s1 != 0 || ref.s2 != 0 || ref.s3 != 0) {
+        return false;
+    }
+    
+    size_t outputSize = Rsc::calculateOutputSize(inputSize);
+    expectedBits.resize(outputSize * 8, 0);
+    vector<uint8_t> expected(outputSize);
+    zeroone2bytearray(outputSize, expectedBits.data(), expected.data());
+    
+    // Encode at once
+    vector<uint8_t> output(outputSize);
+    Rsc rsc(output.data());
+    rsc.encode(input.data(), inputSize);
+    rsc.flush();
+    
+    if (output != expected) {
+        return false;
+    }
+    
+    // Encode in two parts
+    vector<uint8_t> output2(outputSize);
+    rsc.reset(output2.data());
+    rsc.encode(input.data(), inputSize / 2);
+    rsc.encode(input.data() + inputSize / 2, inputSize - inputSize / 2);
+    rsc.flush();
+    
+    return output2 == expected;
+}
+
+bool testTurbo(uint32_t blockBits, uint32_t f1, uint32_t f2) {
+    QppInterleaver interleaver(blockBits, f1, f2);
+    LteTurboEncoder encoder(interleaver);
+    size_t inputSize = encoder.blockSize();
+    
+    vector<uint8_t> input(inputSize);
+    for (size_t i = 0; i < inputSize; i++) {
+        input[i] = rand() % 256;
+    }
+    
+    // Reference
+    vector<uint8_t> inputBits(blockBits), interleavedBits(blockBits);
+    bytearray2zeroone(inputSize, input.data(), inputBits.data());
+    interleaver.interleave(inputBits.data(), interleavedBits.data());
+    
+    vector<uint8_t> expectedBits;
+    ReferenceRsc ref1, ref2;
+    for (uint32_t i = 0; i < blockBits; i++) {
+        expectedBits.push_back(inputBits[i]);
+        expectedBits.push_back(ref1.encode(inputBits[i]));
+        expectedBits.push_back(ref2.encode(interleavedBits[i]));
+    }
+    for (ReferenceRsc *ref : { &ref1, &ref2 }) {
+        for (uint32_t i = 0; i < 3; i++) {
+            uint8_t in = ref->terminationBit();
+            expectedBits.push_back(in);
+            expectedBits.push_back(ref->encode(in));
+        }
+    }
+    
+    size_t outputSize = LteTurboEncoder::calculateOutputSize(inputSize);
+    if (expectedBits.size() != blockBits * 3 + LteTurboEncoder::tailBitCount) {
+        return false;
+    }
+    expectedBits.resize(outputSize * 8, 0);
+    vector<uint8_t> expected(outputSize);
+    zeroone2bytearray(outputSize, expectedBits.data(), expected.data());
+    
+    vector<uint8_t> output(outputSize);
+    encoder.encode(input.data(), output.data());
+    
+    return output == expected;
+}
+
+int main() {
+    srand(time(0));
+    
+    cout << "RSC encoder: ";
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(testRsc(1 + rand() % 100));
+    }
+    cout << "OK" << endl;
+    
+    cout << "Turbo encoder: ";
+    for (uint32_t i = 0; i < 20; i++) {
+        assert(testTurbo(40, 3, 10));
+        assert(testTurbo(1024, 31, 64));
+        assert(testTurbo(6144, 263, 480));
+    }
+    cout << "OK" << endl;
+    
+    return 0;
+}